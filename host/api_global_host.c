@@ -0,0 +1,149 @@
+/**
+ * @file api_global_host.c
+ * @brief Host build of the global API client.
+ *
+ * Runs the real api_global_task() (with http_client.c, outbox.c and lzss.c)
+ * against mock_cloud or any server given at build time by API_GLOBAL_URL and
+ * API_PORT. The device modules it talks to are faked below: the irrigator
+ * keeps a real schedule store and obeys remote commands, the sensor drifts
+ * slowly and the clock is the host's.
+ *
+ * Every exchange prints the cycle line of API_GLOBAL_LOG_CYCLE_STATS (time,
+ * requests, bytes and allocations), which is the benchmark output.
+ *
+ * Usage: api_global_host [seconds]   (runs until killed if omitted)
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "api_global.h"
+#include "aht10.h"
+#include "clock.h"
+#include "irrigator.h"
+#include "schedule.h"
+#include "wifi_connection.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static schedule_store_t store;
+static uint32_t open_until_ms; // 0 = closed
+
+// --- Irrigator ---
+
+int irrigator_is_on(void)
+{
+    return open_until_ms != 0 && (int32_t)(xTaskGetTickCount() - open_until_ms) < 0;
+}
+
+int irrigator_clamp_duration(int seconds)
+{
+    if (seconds < 0)
+        return 0;
+    return seconds > IRRIGATOR_MAX_DURATION_S ? IRRIGATOR_MAX_DURATION_S : seconds;
+}
+
+bool irrigator_zone_valid(int zone)
+{
+    return zone >= -1 && zone < IRRIGATOR_ZONE_COUNT;
+}
+
+bool irrigator_send_command(uint8_t command, uint8_t source, int zone, int duration)
+{
+    printf("Host: irrigator command %d from source %d, zone %d, %d s\n", command, source, zone, duration);
+    if (command == IRRIGATOR_TURN_ON)
+        open_until_ms = xTaskGetTickCount() + pdMS_TO_TICKS(duration * 1000);
+    else
+        open_until_ms = 0;
+    return true;
+}
+
+bool irrigator_set_schedule(int index, const schedule_item_t *item)
+{
+    return schedule_store_set(&store, index, item);
+}
+
+int irrigator_schedules_to_json(char *buffer, size_t size)
+{
+    int offset = snprintf(buffer, size, "[");
+    bool first = true;
+
+    for (int i = 0; i < SCHEDULE_MAX_ENTRIES; i++)
+    {
+        const schedule_item_t *item = &store.entries[i];
+        if (item->days == 0)
+            continue;
+
+        char entry[160];
+        int len = snprintf(entry, sizeof(entry),
+            "%s{\"index\":%d,\"hour\":%d,\"minute\":%d,\"duration\":%d,\"active\":%d,\"zone\":%d,\"days\":%d,\"seasonStart\":%d,\"seasonEnd\":%d}",
+            first ? "" : ",", i, item->hour, item->minute, item->duration, item->active, item->zone, item->days, item->season_start, item->season_end);
+        if (offset + len + 2 > (int)size)
+            break;
+        memcpy(buffer + offset, entry, len);
+        offset += len;
+        first = false;
+    }
+
+    offset += snprintf(buffer + offset, size - offset, "]");
+    return offset;
+}
+
+// --- Sensor: 25.00 °C and 60.00 % moving by 0.01 every second ---
+
+void aht10_get_latest_readings(int32_t *temp, int32_t *hum)
+{
+    uint32_t s = xTaskGetTickCount() / 1000;
+    *temp = 2500 + (int32_t)(s % 200);
+    *hum = 6000 - (int32_t)(s % 400);
+}
+
+// --- Clock and network ---
+
+bool is_ntp_synchronized(void)
+{
+    return true;
+}
+
+bool clock_get_time(datetime_t *t)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    *t = (datetime_t){
+        .year = (int16_t)(tm.tm_year + 1900), .month = (int8_t)(tm.tm_mon + 1), .day = (int8_t)tm.tm_mday,
+        .dotw = (int8_t)tm.tm_wday, .hour = (int8_t)tm.tm_hour, .min = (int8_t)tm.tm_min, .sec = (int8_t)tm.tm_sec,
+    };
+    return true;
+}
+
+int wifi_has_internet(void)
+{
+    return 1;
+}
+
+static void on_alarm(int sig)
+{
+    (void)sig;
+    _exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char **argv)
+{
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    schedule_store_init(&store);
+
+    if (argc > 1)
+    {
+        signal(SIGALRM, on_alarm);
+        alarm((unsigned)atoi(argv[1]));
+    }
+
+    api_global_task(NULL);
+    return EXIT_SUCCESS;
+}
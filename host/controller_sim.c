@@ -0,0 +1,202 @@
+/**
+ * @file controller_sim.c
+ * @brief Irrigation controller on a virtual clock.
+ *
+ * Runs controller.c the way irrigator_task() does: each pass steps the
+ * controller, drives the (fake) relays from the open mask and sleeps until
+ * the next start, the next run end or IRRIGATOR_MAX_SLEEP_MS. Here the sleep
+ * just advances the virtual clock, so a year takes a fraction of a second.
+ * The millisecond clock is 32 bits as on the device and wraps every 49 days.
+ *
+ * Prints one line per relay transition, then checks the run against the
+ * schedule: every start in season ran for its full duration, and no more
+ * zones than the pump capacity were ever open together.
+ *
+ * Usage: controller_sim [-d days] [-q]   (-q: summary only, no trace)
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "controller.h"
+#include "irrigator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIM_ZONES 4
+#define SIM_CAPACITY 2
+#define START_DATE 9497 // 2026-01-01, days since 2000-01-01
+
+// Three zones share the 06:00 start on Monday, Wednesday and Friday, so one
+// waits for the pump; the last two only run in their season.
+static const schedule_item_t sample[] = {
+    {.hour = 6, .minute = 0, .duration = 20 * 60, .active = 1, .zone = 0, .days = SCHEDULE_EVERY_DAY},
+    {.hour = 6, .minute = 0, .duration = 15 * 60, .active = 1, .zone = 1, .days = SCHEDULE_EVERY_DAY},
+    {.hour = 6, .minute = 0, .duration = 10 * 60, .active = 1, .zone = 2,
+     .days = SCHEDULE_MONDAY | SCHEDULE_WEDNESDAY | SCHEDULE_FRIDAY},
+    {.hour = 18, .minute = 30, .duration = 30 * 60, .active = 1, .zone = 3,
+     .days = SCHEDULE_TUESDAY | SCHEDULE_THURSDAY, .season_start = 1101, .season_end = 228},
+    {.hour = 21, .minute = 0, .duration = 45 * 60, .active = 1, .zone = 1, .days = SCHEDULE_SATURDAY,
+     .season_start = 601, .season_end = 831},
+};
+#define SAMPLE_COUNT (int)(sizeof(sample) / sizeof(sample[0]))
+
+static schedule_store_t store;
+static const schedule_store_t *published = &store; // never swapped here
+static controller_t controller;
+static controller_result_t result;
+
+// Fake relays: what the GPIO pins would hold, and for how long each was on
+static uint32_t relays;
+static uint64_t opened_at_ms[SIM_ZONES];
+static uint64_t on_ms[SIM_ZONES];
+static uint32_t openings[SIM_ZONES];
+
+static void virtual_date(uint64_t ms, datetime_t *t)
+{
+    uint64_t s = ms / 1000;
+    schedule_date_of((uint32_t)(START_DATE * 24 * 60 + s / 60), t);
+    t->sec = (int8_t)(s % 60);
+}
+
+static void print_time(uint64_t ms)
+{
+    datetime_t t;
+    virtual_date(ms, &t);
+    printf("%04d-%02d-%02d %02d:%02d:%02d", t.year, t.month, t.day, t.hour, t.min, t.sec);
+}
+
+static void drive_relays(uint32_t mask, uint64_t now, bool trace)
+{
+    for (int z = 0; z < SIM_ZONES; z++)
+    {
+        uint32_t bit = 1u << z;
+        if (!((mask ^ relays) & bit))
+            continue;
+
+        if (mask & bit)
+        {
+            opened_at_ms[z] = now;
+            openings[z]++;
+        }
+        else
+        {
+            on_ms[z] += now - opened_at_ms[z];
+        }
+        if (trace)
+        {
+            print_time(now);
+            printf("  zone %d %s\n", z, (mask & bit) ? "ON" : "OFF");
+        }
+    }
+    relays = mask;
+}
+
+static int popcount(uint32_t mask)
+{
+    int n = 0;
+    for (; mask; mask &= mask - 1)
+        n++;
+    return n;
+}
+
+// Runs and watering time the schedule asks for over the simulated days
+static void expected_runs(int days, uint32_t *runs, uint64_t *ms)
+{
+    memset(runs, 0, SIM_ZONES * sizeof(*runs));
+    memset(ms, 0, SIM_ZONES * sizeof(*ms));
+
+    for (int d = 0; d < days; d++)
+    {
+        datetime_t t;
+        schedule_date_of((uint32_t)(START_DATE + d) * 24 * 60, &t);
+        for (int i = 0; i < SAMPLE_COUNT; i++)
+        {
+            if ((sample[i].days & (1 << t.dotw)) && schedule_in_season(&sample[i], t.month, t.day))
+            {
+                runs[sample[i].zone]++;
+                ms[sample[i].zone] += sample[i].duration * 1000ull;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int days = 365;
+    bool trace = true;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:q")) != -1)
+    {
+        if (opt == 'd')
+            days = atoi(optarg);
+        else if (opt == 'q')
+            trace = false;
+        else
+        {
+            fprintf(stderr, "Usage: %s [-d days] [-q]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    schedule_store_init(&store);
+    for (int i = 0; i < SAMPLE_COUNT; i++)
+        schedule_store_set(&store, i, &sample[i]);
+    controller_init(&controller, &published, NULL, SIM_ZONES, SIM_CAPACITY);
+    controller.missed_policy = IRRIGATOR_MISSED_POLICY;
+    controller.catchup_window_min = IRRIGATOR_CATCHUP_WINDOW_MIN;
+
+    uint64_t now = 0;
+    uint64_t end = (uint64_t)days * 24 * 3600 * 1000;
+    uint64_t passes = 0;
+    int max_open = 0;
+    int lost = 0;
+    clock_t started = clock();
+
+    while (now < end)
+    {
+        datetime_t t;
+        virtual_date(now, &t);
+        controller_step(&controller, &t, (uint32_t)now, &result);
+        drive_relays(result.open_mask, now, trace);
+        passes++;
+        lost += result.events_lost + result.starts_dropped;
+        if (popcount(result.open_mask) > max_open)
+            max_open = popcount(result.open_mask);
+
+        // The wake up irrigator_task() would set (starts) or the stop alarm (ends)
+        uint64_t sleep = IRRIGATOR_MAX_SLEEP_MS;
+        if (result.next_start_s >= 0 && (uint64_t)result.next_start_s * 1000 < sleep)
+            sleep = (uint64_t)result.next_start_s * 1000;
+        if (result.next_stop_ms != ZONES_NO_DEADLINE && result.next_stop_ms < sleep)
+            sleep = result.next_stop_ms;
+        now += sleep > 0 ? sleep : 1;
+    }
+    drive_relays(0, end, false); // account for runs still open at the end
+
+    double cpu_s = (double)(clock() - started) / CLOCKS_PER_SEC;
+    printf("%d days in %llu passes, %.3f s (%.0fx real time)\n", days, (unsigned long long)passes, cpu_s,
+           cpu_s > 0 ? days * 86400.0 / cpu_s : 0);
+
+    uint32_t runs[SIM_ZONES];
+    uint64_t want_ms[SIM_ZONES];
+    expected_runs(days, runs, want_ms);
+
+    bool ok = max_open <= SIM_CAPACITY && lost == 0;
+    for (int z = 0; z < SIM_ZONES; z++)
+    {
+        bool match = openings[z] == runs[z] && on_ms[z] == want_ms[z];
+        printf("zone %d: %u runs, %llu min (expected %u runs, %llu min)%s\n", z, openings[z],
+               (unsigned long long)(on_ms[z] / 60000), runs[z], (unsigned long long)(want_ms[z] / 60000),
+               match ? "" : "  MISMATCH");
+        ok = ok && match;
+    }
+    printf("At most %d zones open at once (pump capacity %d), %d starts lost\n", max_open, SIM_CAPACITY, lost);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
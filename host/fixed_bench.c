@@ -0,0 +1,142 @@
+/**
+ * @file fixed_bench.c
+ * @brief Fixed-point sensor path against the float one it replaced.
+ *
+ * Per sample: the AHT10 conversion in aht10.h against the datasheet float
+ * formula, over every 20-bit raw value. Per response: fixed_format() against
+ * snprintf("%.2f"), and a /status-like body with two readings built both ways.
+ *
+ * Fails if a converted value differs from the rounded float one by more than
+ * one hundredth, or if fixed_format() disagrees with an integer reference.
+ * Timings are reported, not judged. The host has an FPU, so the conversion
+ * numbers understate what the M0+ saves (there every float operation is a
+ * library call); the formatting numbers are closer, since "%.2f" goes
+ * through the same long printf float path on both.
+ *
+ * Usage: fixed_bench [iterations]
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "aht10.h"
+#include "fixed.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RAW_VALUES (1u << 20)
+
+static volatile int32_t sink; // keeps the timed code from being optimized out
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static float float_humidity(uint32_t raw)
+{
+    return raw / 1048576.0f * 100.0f;
+}
+
+static float float_celsius(uint32_t raw)
+{
+    return raw / 1048576.0f * 200.0f - 50.0f;
+}
+
+static bool check_conversion(void)
+{
+    for (uint32_t raw = 0; raw < RAW_VALUES; raw++)
+    {
+        long want_h = lroundf(float_humidity(raw) * 100.0f);
+        long want_t = lroundf(float_celsius(raw) * 100.0f);
+        if (labs(aht10_centi_humidity(raw) - want_h) > 1 || labs(aht10_centi_celsius(raw) - want_t) > 1)
+        {
+            printf("FAIL: raw %lu: %ld/%ld cRH, %ld/%ld cC\n", (unsigned long)raw, (long)aht10_centi_humidity(raw), want_h,
+                   (long)aht10_centi_celsius(raw), want_t);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool check_format(void)
+{
+    char got[FIXED_STR_SIZE], want[32];
+
+    for (int32_t v = -100000; v <= 100000; v++)
+    {
+        fixed_format(got, v, 2);
+        snprintf(want, sizeof(want), "%s%ld.%02ld", v < 0 ? "-" : "", labs(v) / 100, labs(v) % 100);
+        if (strcmp(got, want) != 0)
+        {
+            printf("FAIL: fixed_format(%ld, 2) = %s, expected %s\n", (long)v, got, want);
+            return false;
+        }
+    }
+    fixed_format(got, INT32_MIN, 2);
+    if (strcmp(got, "-21474836.48") != 0)
+    {
+        printf("FAIL: fixed_format(INT32_MIN, 2) = %s\n", got);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+    char buffer[128], temp[FIXED_STR_SIZE], hum[FIXED_STR_SIZE];
+
+    if (!check_conversion() || !check_format())
+        return EXIT_FAILURE;
+
+    // Per sample: one temperature and one humidity conversion
+    double start = now_ns();
+    for (uint32_t raw = 0; raw < RAW_VALUES; raw++)
+        sink += aht10_centi_celsius(raw) + aht10_centi_humidity(raw);
+    double fixed_sample = (now_ns() - start) / RAW_VALUES;
+
+    start = now_ns();
+    for (uint32_t raw = 0; raw < RAW_VALUES; raw++)
+        sink += (int32_t)(float_celsius(raw) + float_humidity(raw));
+    double float_sample = (now_ns() - start) / RAW_VALUES;
+
+    // Per value formatted
+    start = now_ns();
+    for (int i = 0; i < iterations; i++)
+        sink += fixed_format(buffer, i - iterations / 2, 2);
+    double fixed_value = (now_ns() - start) / iterations;
+
+    start = now_ns();
+    for (int i = 0; i < iterations; i++)
+        sink += snprintf(buffer, sizeof(buffer), "%.2f", (i - iterations / 2) / 100.0f);
+    double float_value = (now_ns() - start) / iterations;
+
+    // Per response: the readings part of GET /status
+    start = now_ns();
+    for (int i = 0; i < iterations; i++)
+    {
+        fixed_format(temp, 2500 + i % 1000, 2);
+        fixed_format(hum, 6000 - i % 1000, 2);
+        sink += snprintf(buffer, sizeof(buffer), "{\"temperature\": %s, \"humidity\": %s}", temp, hum);
+    }
+    double fixed_response = (now_ns() - start) / iterations;
+
+    start = now_ns();
+    for (int i = 0; i < iterations; i++)
+        sink += snprintf(buffer, sizeof(buffer), "{\"temperature\": %.2f, \"humidity\": %.2f}", (2500 + i % 1000) / 100.0f,
+                         (6000 - i % 1000) / 100.0f);
+    double float_response = (now_ns() - start) / iterations;
+
+    printf("%-22s %10s %10s\n", "ns per", "fixed", "float");
+    printf("%-22s %10.1f %10.1f\n", "sample (conversion)", fixed_sample, float_sample);
+    printf("%-22s %10.1f %10.1f\n", "value (formatting)", fixed_value, float_value);
+    printf("%-22s %10.1f %10.1f\n", "response (2 readings)", fixed_response, float_response);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file flow_check.c
+ * @brief flow.c against a simulated flow sensor.
+ *
+ * The sensor is the PWM counter of host_port.c fed at a random rate, with
+ * pulses landing between the reads inside flow_get_count() too, so reads
+ * race with counter wraps the way they do on the device. Some pulses come
+ * through flow_inject_pulses() instead, as in a simulation without a sensor.
+ *
+ * Fails if a reading is ever below the pulses produced before it or above
+ * those produced by its end, if the total is off once the sensor stops, or
+ * if a wrap interrupt is taken for anything but a 65536-pulse wrap.
+ *
+ * Usage: flow_check [litres]
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "flow.h"
+#include "hardware/pwm.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint64_t produced; // pulses out of the simulated sensor and injected
+static uint32_t per_read; // at most this many pulses arrive during each counter read
+
+static uint32_t sensor(uint slice_num)
+{
+    (void)slice_num;
+    uint32_t pulses = per_read ? (uint32_t)rand() % (per_read + 1) : 0;
+    produced += pulses;
+    return pulses;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t target = (uint64_t)(argc > 1 ? atoi(argv[1]) : 100000) * FLOW_PULSES_PER_LITRE;
+    uint64_t injected = 0;
+    uint64_t last = 0;
+    uint32_t reads = 0;
+
+    srand(1);
+    flow_init();
+    host_pwm_set_source(sensor);
+
+    while (produced < target)
+    {
+        // Between reads: the sensor keeps pulsing, sometimes a simulated flow is injected
+        uint32_t pulses = (uint32_t)rand() % 20000;
+        host_pwm_pulses(pwm_gpio_to_slice_num(FLOW_SENSOR_PIN), pulses);
+        produced += pulses;
+        if (rand() % 16 == 0)
+        {
+            flow_inject_pulses(1000);
+            produced += 1000;
+            injected += 1000;
+        }
+
+        per_read = (uint32_t)rand() % 4 == 0 ? 3000 : 0;
+        uint64_t before = produced;
+        uint64_t count = flow_get_count();
+        reads++;
+        if (count < before || count > produced || count < last)
+        {
+            printf("FAIL: read %lu: %llu pulses, produced %llu to %llu, last read %llu\n", (unsigned long)reads,
+                   (unsigned long long)count, (unsigned long long)before, (unsigned long long)produced,
+                   (unsigned long long)last);
+            return EXIT_FAILURE;
+        }
+        last = count;
+    }
+
+    per_read = 0;
+    uint64_t total = flow_get_count();
+    uint32_t irqs = host_pwm_wrap_irqs();
+    printf("%llu pulses (%lu dl) in %lu reads, %lu wrap interrupts\n", (unsigned long long)total,
+           (unsigned long)flow_pulses_to_dl(total), (unsigned long)reads, (unsigned long)irqs);
+
+    if (total != produced)
+    {
+        printf("FAIL: counted %llu pulses, produced %llu\n", (unsigned long long)total, (unsigned long long)produced);
+        return EXIT_FAILURE;
+    }
+    if (irqs != (produced - injected) >> 16)
+    {
+        printf("FAIL: %lu wrap interrupts for %llu counted pulses\n", (unsigned long)irqs,
+               (unsigned long long)(produced - injected));
+        return EXIT_FAILURE;
+    }
+    if (flow_pulses_to_dl(FLOW_PULSES_PER_LITRE) != 10 || flow_pulses_to_dl(FLOW_PULSES_PER_LITRE / 10) != 1 ||
+        flow_pulses_to_dl(FLOW_PULSES_PER_LITRE / 20) != 0)
+    {
+        printf("FAIL: pulse to decilitre conversion\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
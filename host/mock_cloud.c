@@ -0,0 +1,520 @@
+/**
+ * @file mock_cloud.c
+ * @brief Stand-in for the cloud backend, to run the global API client against on Linux.
+ *
+ * Serves the endpoints api_global.c uses, each connection on its own thread:
+ *
+ *   POST /device/login     {"token": ...}
+ *   POST /device/sync      schedule deltas since the version sent, plus queued commands
+ *   GET  /device/commands  long poll: held up to the requested wait, then 204
+ *   POST /device/events    accepted and counted
+ *   POST /telemetry        accepted and counted (older firmware)
+ *
+ * Options:
+ *   -p port         listen port (8080)
+ *   -l ms           latency added before every response (0)
+ *   -e percent      share of requests answered with 500 (0)
+ *   -t seconds      token lifetime; requests with an expired token get 401 (0 = never)
+ *   -s count        schedule entries sent to a device with an old version (4)
+ *   -w ms           longest hold of a command poll (25000)
+ *   -k count        queue an irrigate command every count polls (0 = never)
+ *   -c              advertise and accept x-lzss bodies, compress responses
+ *   -C cert -K key  serve TLS 1.2 with this PEM certificate chain and key
+ *                   (builds with OpenSSL only); each handshake is logged as
+ *                   full or resumed
+ *
+ * Totals are printed on SIGINT/SIGTERM.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#define _GNU_SOURCE
+#include "lzss.h"
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HOST_TLS
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+#define MAX_REQUEST 65536
+#define MAX_RESPONSE 65536
+#define ENCODING "x-lzss"
+
+typedef struct
+{
+    int port;
+    int latency_ms;
+    int error_percent;
+    int token_ttl_s;
+    int schedules;
+    int poll_hold_ms;
+    int command_every;
+    bool compression;
+    const char *tls_cert;
+    const char *tls_key;
+} options_t;
+
+// An accepted connection; ssl is NULL without TLS
+typedef struct
+{
+    int fd;
+    void *ssl;
+} conn_t;
+
+typedef struct
+{
+    int status;
+    char body[MAX_RESPONSE];
+} response_t;
+
+static options_t options = { 8080, 0, 0, 0, 4, 25000, 0, false, NULL, NULL };
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static char token[32];
+static time_t token_issued;
+static unsigned token_count;
+static unsigned schedule_version = 1;
+static unsigned polls;
+static bool command_queued;
+static struct
+{
+    unsigned requests, logins, syncs, polls, events, telemetry, unauthorized, injected_errors;
+    unsigned tls_full, tls_resumed, tls_failed;
+    unsigned long bytes_in, bytes_out;
+} totals;
+
+#ifdef HOST_TLS
+static SSL_CTX *tls_ctx;
+#endif
+
+static const char *reason(int status)
+{
+    switch (status)
+    {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 415: return "Unsupported Media Type";
+    default: return "Internal Server Error";
+    }
+}
+
+static unsigned json_uint(const char *json, const char *key)
+{
+    const char *p = strstr(json, key);
+    p = p ? strchr(p, ':') : NULL;
+    return p ? (unsigned)strtoul(p + 1, NULL, 10) : 0;
+}
+
+// Finds a header value in the raw header block (case-insensitive name)
+static bool header(const char *headers, const char *name, char *value, size_t size)
+{
+    size_t name_len = strlen(name);
+    for (const char *line = headers; line && *line; line = strstr(line, "\r\n") ? strstr(line, "\r\n") + 2 : NULL)
+    {
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':')
+        {
+            const char *v = line + name_len + 1;
+            while (*v == ' ')
+                v++;
+            size_t len = strcspn(v, "\r\n");
+            if (len >= size)
+                len = size - 1;
+            memcpy(value, v, len);
+            value[len] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool authorized(const char *headers)
+{
+    char value[128];
+    if (!header(headers, "Authorization", value, sizeof(value)) || strncmp(value, "Bearer ", 7) != 0)
+        return false;
+
+    pthread_mutex_lock(&lock);
+    bool ok = token[0] && strcmp(value + 7, token) == 0 &&
+              (options.token_ttl_s == 0 || time(NULL) - token_issued < options.token_ttl_s);
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+// Everything changed since version: the whole set, since the mock keeps no history
+static int write_updates(char *out, size_t size, unsigned device_version)
+{
+    pthread_mutex_lock(&lock);
+    unsigned version = schedule_version;
+    bool command = command_queued;
+    command_queued = false;
+    pthread_mutex_unlock(&lock);
+
+    int offset = snprintf(out, size, "{\"scheduleVersion\":%u,\"schedules\":[", version);
+    for (int i = 0; device_version != version && i < options.schedules && offset < (int)size; i++)
+    {
+        offset += snprintf(out + offset, size - offset,
+            "%s{\"index\":%d,\"hour\":%d,\"minute\":%d,\"duration\":%d,\"active\":true,\"days\":127}",
+            i ? "," : "", i, 5 + i % 14, (i * 7) % 60, 60 + i % 600);
+    }
+    if (offset < (int)size)
+        offset += snprintf(out + offset, size - offset, "],\"commands\":[%s]}",
+            command ? "{\"action\":\"irrigate\",\"zone\":0,\"duration\":5}" : "");
+    return offset;
+}
+
+static void route(const char *method, const char *path, const char *headers, const char *body, response_t *r)
+{
+    r->status = 200;
+    r->body[0] = '\0';
+
+    if (strcmp(method, "POST") == 0 && strcmp(path, "/device/login") == 0)
+    {
+        pthread_mutex_lock(&lock);
+        snprintf(token, sizeof(token), "mock-token-%u", ++token_count);
+        token_issued = time(NULL);
+        totals.logins++;
+        snprintf(r->body, sizeof(r->body), "{\"token\":\"%s\"}", token);
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    if (!authorized(headers))
+    {
+        __atomic_fetch_add(&totals.unauthorized, 1, __ATOMIC_RELAXED);
+        r->status = 401;
+        snprintf(r->body, sizeof(r->body), "{\"error\":\"unauthorized\"}");
+        return;
+    }
+
+    if (strcmp(method, "POST") == 0 && strcmp(path, "/device/sync") == 0)
+    {
+        __atomic_fetch_add(&totals.syncs, 1, __ATOMIC_RELAXED);
+        write_updates(r->body, sizeof(r->body), json_uint(body, "\"scheduleVersion\""));
+    }
+    else if (strcmp(method, "GET") == 0 && strncmp(path, "/device/commands", 16) == 0)
+    {
+        const char *query = strchr(path, '?');
+        const char *version = query ? strstr(query, "scheduleVersion=") : NULL;
+        unsigned device_version = version ? (unsigned)strtoul(version + 16, NULL, 10) : 0;
+
+        pthread_mutex_lock(&lock);
+        totals.polls++;
+        if (options.command_every > 0 && ++polls % options.command_every == 0)
+            command_queued = true;
+        bool pending = command_queued || device_version != schedule_version;
+        pthread_mutex_unlock(&lock);
+
+        if (pending)
+        {
+            write_updates(r->body, sizeof(r->body), device_version);
+            return;
+        }
+
+        const char *w = query ? strstr(query, "wait=") : NULL;
+        int hold_ms = w ? atoi(w + 5) * 1000 : 0;
+        if (hold_ms > options.poll_hold_ms)
+            hold_ms = options.poll_hold_ms;
+        usleep((useconds_t)hold_ms * 1000);
+        r->status = 204;
+    }
+    else if (strcmp(method, "POST") == 0 && strcmp(path, "/device/events") == 0)
+    {
+        unsigned count = 0;
+        for (const char *p = body; (p = strstr(p, "\"type\"")) != NULL; p++)
+            count++;
+        __atomic_fetch_add(&totals.events, count, __ATOMIC_RELAXED);
+        snprintf(r->body, sizeof(r->body), "{\"accepted\":%u}", count);
+    }
+    else if (strcmp(method, "POST") == 0 && strcmp(path, "/telemetry") == 0)
+    {
+        __atomic_fetch_add(&totals.telemetry, 1, __ATOMIC_RELAXED);
+        snprintf(r->body, sizeof(r->body), "{}");
+    }
+    else
+    {
+        r->status = 404;
+        snprintf(r->body, sizeof(r->body), "{\"error\":\"not found\"}");
+    }
+}
+
+static ssize_t conn_send(conn_t *c, const void *data, size_t len)
+{
+#ifdef HOST_TLS
+    if (c->ssl)
+        return SSL_write(c->ssl, data, (int)len);
+#endif
+    return send(c->fd, data, len, MSG_NOSIGNAL);
+}
+
+static ssize_t conn_recv(conn_t *c, void *data, size_t len)
+{
+#ifdef HOST_TLS
+    if (c->ssl)
+        return SSL_read(c->ssl, data, (int)len);
+#endif
+    return recv(c->fd, data, len, 0);
+}
+
+// TLS handshake, logged as full or resumed; true to go on with the request
+static bool conn_accept(conn_t *c)
+{
+#ifdef HOST_TLS
+    if (!tls_ctx)
+        return true;
+
+    SSL *ssl = SSL_new(tls_ctx);
+    SSL_set_fd(ssl, c->fd);
+    if (SSL_accept(ssl) != 1)
+    {
+        __atomic_fetch_add(&totals.tls_failed, 1, __ATOMIC_RELAXED);
+        printf("Mock: TLS handshake failed: %s\n", ERR_reason_error_string(ERR_get_error()));
+        ERR_clear_error();
+        SSL_free(ssl);
+        return false;
+    }
+    c->ssl = ssl;
+
+    bool resumed = SSL_session_reused(ssl);
+    __atomic_fetch_add(resumed ? &totals.tls_resumed : &totals.tls_full, 1, __ATOMIC_RELAXED);
+    int mfl = SSL_SESSION_get_max_fragment_length(SSL_get_session(ssl)); // the client's max_fragment_length
+    printf("Mock: TLS %s handshake, %s, records up to %d B\n", resumed ? "resumed" : "full", SSL_get_cipher_name(ssl),
+        mfl == TLSEXT_max_fragment_length_DISABLED ? 16384 : 256 << mfl);
+#endif
+    return true;
+}
+
+static void conn_close(conn_t *c)
+{
+#ifdef HOST_TLS
+    if (c->ssl)
+    {
+        SSL_shutdown(c->ssl);
+        SSL_free(c->ssl);
+    }
+#endif
+    shutdown(c->fd, SHUT_WR);
+    close(c->fd);
+}
+
+static void send_all(conn_t *c, const void *data, size_t len)
+{
+    const char *p = data;
+    while (len > 0)
+    {
+        ssize_t n = conn_send(c, p, len);
+        if (n <= 0)
+            return;
+        p += n;
+        len -= (size_t)n;
+        __atomic_fetch_add(&totals.bytes_out, (unsigned long)n, __ATOMIC_RELAXED);
+    }
+}
+
+static void respond(conn_t *c, const response_t *r, bool compress)
+{
+    static __thread uint8_t packed[MAX_RESPONSE];
+    const void *body = r->body;
+    size_t len = strlen(r->body);
+    size_t packed_len = compress && len > 0 ? lzss_compress((const uint8_t *)r->body, len, packed, sizeof(packed)) : 0;
+    if (packed_len > 0)
+    {
+        body = packed;
+        len = packed_len;
+    }
+
+    char head[256];
+    int head_len = snprintf(head, sizeof(head),
+        "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n%s%s%sConnection: close\r\n\r\n",
+        r->status, reason(r->status), len,
+        options.compression ? "Accept-Encoding: " ENCODING "\r\n" : "",
+        packed_len > 0 ? "Content-Encoding: " ENCODING : "", packed_len > 0 ? "\r\n" : "");
+    send_all(c, head, (size_t)head_len);
+    send_all(c, body, len);
+}
+
+static void *serve(void *arg)
+{
+    conn_t conn = { .fd = (int)(intptr_t)arg };
+    static __thread char request[MAX_REQUEST + 1];
+    static __thread uint8_t decoded[MAX_REQUEST + 1];
+    static __thread response_t response;
+    size_t got = 0;
+    char *body = NULL;
+    size_t content_length = 0;
+
+    if (!conn_accept(&conn))
+    {
+        close(conn.fd);
+        return NULL;
+    }
+
+    // Headers, then the body announced by Content-Length
+    while (got < MAX_REQUEST)
+    {
+        ssize_t n = conn_recv(&conn, request + got, MAX_REQUEST - got);
+        if (n <= 0)
+            break;
+        got += (size_t)n;
+        request[got] = '\0';
+        __atomic_fetch_add(&totals.bytes_in, (unsigned long)n, __ATOMIC_RELAXED);
+
+        if (!body && (body = strstr(request, "\r\n\r\n")) != NULL)
+        {
+            char value[32];
+            body += 4;
+            content_length = header(request, "Content-Length", value, sizeof(value)) ? strtoul(value, NULL, 10) : 0;
+        }
+        if (body && got - (size_t)(body - request) >= content_length)
+            break;
+    }
+    if (!body)
+    {
+        conn_close(&conn);
+        return NULL;
+    }
+    body[-2] = '\0'; // headers end at the blank line
+    body[content_length < MAX_REQUEST ? content_length : 0] = '\0';
+    __atomic_fetch_add(&totals.requests, 1, __ATOMIC_RELAXED);
+
+    char method[8] = { 0 }, path[256] = { 0 }, encoding[32];
+    sscanf(request, "%7s %255s", method, path);
+    const char *headers = strstr(request, "\r\n") + 2;
+
+    bool encoded = header(headers, "Content-Encoding", encoding, sizeof(encoding));
+    if (encoded && (!options.compression || strcmp(encoding, ENCODING) != 0))
+    {
+        response.status = 415;
+        snprintf(response.body, sizeof(response.body), "{\"error\":\"unsupported encoding\"}");
+    }
+    else
+    {
+        if (encoded)
+        {
+            lzss_decoder_t decoder;
+            size_t out_len = 0;
+            lzss_decoder_init(&decoder);
+            lzss_decode(&decoder, (const uint8_t *)body, content_length, decoded, &out_len, MAX_REQUEST);
+            decoded[out_len] = '\0';
+            body = (char *)decoded;
+        }
+
+        if (options.latency_ms > 0)
+            usleep((useconds_t)options.latency_ms * 1000);
+
+        if (options.error_percent > 0 && rand() % 100 < options.error_percent)
+        {
+            __atomic_fetch_add(&totals.injected_errors, 1, __ATOMIC_RELAXED);
+            response.status = 500;
+            snprintf(response.body, sizeof(response.body), "{\"error\":\"injected\"}");
+        }
+        else
+        {
+            route(method, path, headers, body, &response);
+        }
+    }
+
+    printf("Mock: %s %s -> %d\n", method, path, response.status);
+    char accept[64];
+    respond(&conn, &response, options.compression && header(headers, "Accept-Encoding", accept, sizeof(accept)) && strstr(accept, ENCODING));
+    conn_close(&conn);
+    return NULL;
+}
+
+static void print_totals(int sig)
+{
+    (void)sig;
+    printf("Mock: %u requests (%u logins, %u syncs, %u polls, %u events, %u telemetry), %u unauthorized, %u injected errors, in %lu B, out %lu B\n",
+        totals.requests, totals.logins, totals.syncs, totals.polls, totals.events, totals.telemetry,
+        totals.unauthorized, totals.injected_errors, totals.bytes_in, totals.bytes_out);
+    if (options.tls_cert)
+        printf("Mock: TLS handshakes: %u full, %u resumed, %u failed\n", totals.tls_full, totals.tls_resumed, totals.tls_failed);
+    fflush(stdout);
+    _exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "p:l:e:t:s:w:k:cC:K:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p': options.port = atoi(optarg); break;
+        case 'l': options.latency_ms = atoi(optarg); break;
+        case 'e': options.error_percent = atoi(optarg); break;
+        case 't': options.token_ttl_s = atoi(optarg); break;
+        case 's': options.schedules = atoi(optarg); break;
+        case 'w': options.poll_hold_ms = atoi(optarg); break;
+        case 'k': options.command_every = atoi(optarg); break;
+        case 'c': options.compression = true; break;
+        case 'C': options.tls_cert = optarg; break;
+        case 'K': options.tls_key = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-p port] [-l latency_ms] [-e error_percent] [-t token_ttl_s] [-s schedules] [-w poll_hold_ms] [-k command_every] [-c] [-C cert -K key]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    signal(SIGINT, print_totals);
+    signal(SIGTERM, print_totals);
+    srand((unsigned)time(NULL));
+
+    if (options.tls_cert || options.tls_key)
+    {
+#ifdef HOST_TLS
+        // Session IDs are cached and tickets issued by default, as a TLS 1.2 server would
+        tls_ctx = SSL_CTX_new(TLS_server_method());
+        if (!options.tls_cert || !options.tls_key || !tls_ctx ||
+            SSL_CTX_use_certificate_chain_file(tls_ctx, options.tls_cert) != 1 ||
+            SSL_CTX_use_PrivateKey_file(tls_ctx, options.tls_key, SSL_FILETYPE_PEM) != 1)
+        {
+            fprintf(stderr, "Mock: cannot load the TLS certificate and key (-C and -K)\n");
+            return EXIT_FAILURE;
+        }
+#else
+        fprintf(stderr, "Mock: built without OpenSSL, no TLS\n");
+        return EXIT_FAILURE;
+#endif
+    }
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)options.port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (bind(server, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(server, 16) != 0)
+    {
+        perror("Mock: listen");
+        return EXIT_FAILURE;
+    }
+    printf("Mock: listening on 127.0.0.1:%d%s\n", options.port, options.tls_cert ? " (TLS)" : "");
+
+    while (true)
+    {
+        int fd = accept(server, NULL, NULL);
+        if (fd < 0)
+            continue;
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve, (void *)(intptr_t)fd) != 0)
+        {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
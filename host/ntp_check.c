@@ -0,0 +1,163 @@
+/**
+ * @file ntp_check.c
+ * @brief Rounds of ntp.c against simulated NTP servers.
+ *
+ * Stands in for the servers and the network of a clock_sync_task() round:
+ * each server answers the real request bytes from ntp_build_request() with a
+ * reply built from its own clock, across random and asymmetric one-way
+ * delays, and some replies are lost. One server is a falseticker, seconds off.
+ * The replies go through ntp_parse_reply(), the burst through ntp_filter()
+ * and the servers through ntp_select(), as in clock.c.
+ *
+ * Fails if a round selects an offset farther from the truth than the
+ * error bound of the sample it chose, or follows the falseticker, or if a
+ * stale, unsynchronized or kiss-o'-death reply is accepted.
+ *
+ * Usage: ntp_check [rounds]
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "ntp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERVERS 4
+#define BURST 4
+#define FALSETICKER_US 3000000 // its clock is this far off
+#define LOSS_PERCENT 10
+#define SERVER_PROCESSING_US 300
+
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    for (int i = 7; i >= 0; i--, v >>= 8)
+        p[i] = (uint8_t)v;
+}
+
+static int64_t random_between(int64_t low, int64_t high)
+{
+    return low + (int64_t)(rand() % (int)(high - low + 1));
+}
+
+// The server's reply to a request, from a clock that is offset_us ahead of ours
+static void serve(const uint8_t *request, int64_t arrives_us, int64_t offset_us, uint8_t *reply)
+{
+    memset(reply, 0, NTP_MSG_LEN);
+    reply[0] = (0 << 6) | (4 << 3) | 4; // no leap warning, version 4, server
+    reply[1] = 2;                       // stratum
+    reply[7] = 0x10;                    // root delay 1/4096 s
+    reply[11] = 0x08;                   // root dispersion 1/8192 s
+    memcpy(reply + 24, request + 40, 8);                                    // origin = T1
+    put_u64(reply + 32, ntp_from_epoch_us(arrives_us + offset_us));         // T2
+    put_u64(reply + 40, ntp_from_epoch_us(arrives_us + offset_us + SERVER_PROCESSING_US)); // T3
+}
+
+// One exchange; false if the reply was lost or rejected
+static bool exchange(int64_t *now_us, int64_t offset_us, ntp_sample_t *sample)
+{
+    uint8_t request[NTP_MSG_LEN], reply[NTP_MSG_LEN];
+    uint64_t t1 = ntp_from_epoch_us(*now_us);
+    ntp_build_request(request, t1);
+
+    int64_t out = random_between(2000, 60000); // one-way delays, independent in each direction
+    int64_t back = random_between(2000, 60000);
+    serve(request, *now_us + out, offset_us, reply);
+    *now_us += out + SERVER_PROCESSING_US + back;
+
+    if (rand() % 100 < LOSS_PERCENT)
+        return false;
+    return ntp_parse_reply(reply, NTP_MSG_LEN, t1, *now_us, sample);
+}
+
+static bool check_rejections(void)
+{
+    uint8_t request[NTP_MSG_LEN], reply[NTP_MSG_LEN];
+    ntp_sample_t sample;
+    int64_t now = 1760000000LL * 1000000;
+    uint64_t t1 = ntp_from_epoch_us(now);
+    ntp_build_request(request, t1);
+
+    serve(request, now + 10000, 0, reply);
+    if (ntp_parse_reply(reply, NTP_MSG_LEN, t1 + 1, now + 20000, &sample))
+    {
+        printf("FAIL: accepted a reply to another request\n");
+        return false;
+    }
+
+    serve(request, now + 10000, 0, reply);
+    reply[0] |= 3 << 6;
+    if (ntp_parse_reply(reply, NTP_MSG_LEN, t1, now + 20000, &sample))
+    {
+        printf("FAIL: accepted an unsynchronized server\n");
+        return false;
+    }
+
+    serve(request, now + 10000, 0, reply);
+    reply[1] = 0;
+    if (ntp_parse_reply(reply, NTP_MSG_LEN, t1, now + 20000, &sample))
+    {
+        printf("FAIL: accepted a kiss-o'-death\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10000;
+    int64_t worst_us = 0;
+    int64_t total_us = 0;
+    int selected = 0;
+
+    if (!check_rejections())
+        return EXIT_FAILURE;
+
+    srand(1);
+    for (int r = 0; r < rounds; r++)
+    {
+        int64_t now = 1760000000LL * 1000000 + r * 1000000LL;
+        int64_t truth = random_between(-2000000, 2000000); // how far our clock is behind
+        ntp_sample_t best[SERVERS] = {0};
+
+        for (int pass = 0; pass < BURST; pass++)
+        {
+            for (int s = 0; s < SERVERS; s++)
+            {
+                ntp_sample_t sample;
+                int64_t offset = s == 0 ? truth + FALSETICKER_US : truth;
+                if (exchange(&now, offset, &sample))
+                    ntp_filter(&best[s], &sample);
+            }
+        }
+
+        int64_t offset;
+        if (ntp_select(best, SERVERS, &offset) == 0)
+            continue; // too many replies lost to form a majority; clock.c retries later
+
+        // The chosen sample is one of the truechimers, so the truth is within its bound
+        int64_t error = offset > truth ? offset - truth : truth - offset;
+        int64_t bound = 0;
+        for (int s = 1; s < SERVERS; s++)
+        {
+            if (best[s].valid && best[s].offset_us == offset)
+                bound = best[s].error_us;
+        }
+        if (bound == 0 || error > bound)
+        {
+            printf("FAIL: round %d: offset %lld, truth %lld\n", r, (long long)offset, (long long)truth);
+            return EXIT_FAILURE;
+        }
+
+        selected++;
+        total_us += error;
+        if (error > worst_us)
+            worst_us = error;
+    }
+
+    printf("%d of %d rounds selected an offset: error mean %lld us, worst %lld us\n", selected, rounds,
+           (long long)(selected ? total_us / selected : 0), (long long)worst_us);
+    return selected > rounds * 9 / 10 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS types and macros used by the modules built in host/.
+ *
+ * The process is the only task, and lwIP callbacks run on its own thread from
+ * inside ulTaskNotifyTake() (see host_port.c), so critical sections have
+ * nothing to exclude.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+
+typedef uint32_t TickType_t; // 1 tick = 1 ms, as configTICK_RATE_HZ on the board
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFu
+
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(ticks))
+#define configASSERT(x) assert(x)
+
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+#define taskENTER_CRITICAL() do { } while (0)
+#define taskEXIT_CRITICAL() do { } while (0)
+#define taskENTER_CRITICAL_FROM_ISR() 0
+#define taskEXIT_CRITICAL_FROM_ISR(saved) (void)(saved)
+
+#endif // FREERTOS_H
@@ -0,0 +1,25 @@
+/**
+ * @file irq.h
+ * @brief Host stand-in for the interrupt handler registration (PWM wrap only).
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef HARDWARE_IRQ_H
+#define HARDWARE_IRQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+#define PWM_IRQ_WRAP 4
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_set_enabled(uint num, bool enabled);
+
+#endif // HARDWARE_IRQ_H
@@ -0,0 +1,87 @@
+/**
+ * @file pwm.h
+ * @brief Host stand-in for the PWM slices, as pulse counters only.
+ *
+ * A slice counts the pulses handed to host_pwm_pulses() up to its wrap and
+ * raises the wrap interrupt, as a slice in PWM_DIV_B_RISING mode counts the
+ * rising edges on its B pin. Pulses can also arrive while the counter is
+ * being read, from the source set with host_pwm_set_source().
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef HARDWARE_PWM_H
+#define HARDWARE_PWM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+#define NUM_PWM_SLICES 8
+
+enum pwm_clkdiv_mode
+{
+    PWM_DIV_FREE_RUNNING,
+    PWM_DIV_B_HIGH,
+    PWM_DIV_B_RISING,
+    PWM_DIV_B_FALLING,
+};
+
+typedef struct
+{
+    enum pwm_clkdiv_mode mode;
+    uint16_t wrap;
+} pwm_config;
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+    return (gpio >> 1) & 7;
+}
+
+static inline pwm_config pwm_get_default_config(void)
+{
+    return (pwm_config){ PWM_DIV_FREE_RUNNING, 0xFFFF };
+}
+
+static inline void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode)
+{
+    c->mode = mode;
+}
+
+static inline void pwm_config_set_clkdiv(pwm_config *c, float div)
+{
+    (void)c;
+    (void)div;
+}
+
+static inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap)
+{
+    c->wrap = wrap;
+}
+
+void pwm_init(uint slice_num, pwm_config *c, bool start);
+void pwm_set_enabled(uint slice_num, bool enabled);
+void pwm_set_irq_enabled(uint slice_num, bool enabled);
+void pwm_clear_irq(uint slice_num);
+uint32_t pwm_get_irq_status_mask(void);
+uint16_t pwm_get_counter(uint slice_num);
+
+/**
+ * @brief Feeds pulses to a slice: counts them and raises the wrap interrupt.
+ */
+void host_pwm_pulses(uint slice_num, uint32_t pulses);
+
+/**
+ * @brief Pulses arriving at each counter read (NULL for none), to land them
+ * between the reads of a caller.
+ */
+void host_pwm_set_source(uint32_t (*source)(uint slice_num));
+
+/**
+ * @brief Wrap interrupts handled so far.
+ */
+uint32_t host_pwm_wrap_irqs(void);
+
+#endif // HARDWARE_PWM_H
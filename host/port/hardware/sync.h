@@ -0,0 +1,53 @@
+/**
+ * @file sync.h
+ * @brief Host stand-in for the interrupt masking and barriers used by seqlock.c.
+ *
+ * Masking only holds back the simulated interrupts of host_port.c (the PWM
+ * wrap), which run when the mask is restored. The barrier is a full fence,
+ * so the seqlock keeps its ordering guarantees between host threads. A
+ * writer can be preempted mid-update, so a spinning reader yields to let it
+ * finish.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef HARDWARE_SYNC_H
+#define HARDWARE_SYNC_H
+
+#include <sched.h>
+#include <stdint.h>
+
+extern _Thread_local uint32_t host_interrupts_masked;
+
+/**
+ * @brief Runs the simulated interrupts raised while they were masked.
+ */
+void host_deliver_interrupts(void);
+
+static inline void tight_loop_contents(void)
+{
+    sched_yield();
+}
+
+static inline uint32_t save_and_disable_interrupts(void)
+{
+    uint32_t saved = host_interrupts_masked;
+    host_interrupts_masked = 1;
+    return saved;
+}
+
+static inline void restore_interrupts(uint32_t saved)
+{
+    host_interrupts_masked = saved;
+    if (!saved)
+        host_deliver_interrupts();
+}
+
+static inline void __dmb(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif // HARDWARE_SYNC_H
@@ -0,0 +1,20 @@
+/**
+ * @file timer.h
+ * @brief Host stand-in for the microsecond timer.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef HARDWARE_TIMER_H
+#define HARDWARE_TIMER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Microseconds since the process started (CLOCK_MONOTONIC).
+ */
+uint64_t time_us_64(void);
+
+#endif // HARDWARE_TIMER_H
@@ -0,0 +1,828 @@
+/**
+ * @file host_port.c
+ * @brief Host implementation of the FreeRTOS, Pico SDK and lwIP stand-ins in host/port.
+ *
+ * A single event loop drives everything: waiting for a task notification
+ * (or sleeping) polls the sockets and runs their lwIP-style callbacks until
+ * one of them gives the notification or the wait ends.
+ *
+ * Built with HOST_TLS, altcp_tls runs on OpenSSL: the handshake and the
+ * records go through the same loop, and "connected" fires once the
+ * handshake is done, as with altcp_mbedtls.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#define _GNU_SOURCE
+#include "FreeRTOS.h"
+#include "task.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/rand.h"
+#include "lwip/altcp.h"
+#include "lwip/altcp_tls.h"
+#include "lwip/dns.h"
+#include "mbedtls/ssl.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HOST_TLS
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+#define MAX_PCBS 16
+#define RECV_CHUNK TCP_MSS
+
+struct altcp_pcb
+{
+    int fd;
+    void *arg;
+    altcp_connected_fn connected;
+    altcp_recv_fn recv;
+    altcp_sent_fn sent;
+    altcp_err_fn err;
+    bool connecting;
+    bool eof;     // peer closed, recv(NULL) already delivered
+    bool closing; // altcp_close(): the socket closes once the queue is flushed
+    bool dead;    // freed at the end of the current poll
+    struct altcp_tls_config *tls; // NULL for plain TCP
+    mbedtls_ssl_context context;  // TLS: the OpenSSL connection
+    bool handshaking;
+    short handshake_wants; // POLLIN or POLLOUT, what the handshake waits for
+    size_t queued;
+    uint8_t queue[TCP_SND_BUF];
+};
+
+struct altcp_tls_config
+{
+    mbedtls_ssl_config conf; // first, as in altcp_tls_mbedtls.c: http_client.c sets options through it
+#ifdef HOST_TLS
+    SSL_CTX *ctx;
+#endif
+};
+
+#ifdef HOST_TLS
+struct altcp_tls_session
+{
+    SSL_SESSION *session;
+};
+#endif
+
+static struct altcp_pcb *pcbs[MAX_PCBS];
+static uint32_t notifications;
+static int dummy_task;
+
+// --- Time and randomness ---
+
+uint64_t time_us_64(void)
+{
+    static struct timespec start;
+    struct timespec now;
+    if (start.tv_sec == 0 && start.tv_nsec == 0)
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - start.tv_sec) * 1000000u + (now.tv_nsec - start.tv_nsec) / 1000;
+}
+
+uint32_t get_rand_32(void)
+{
+    return ((uint32_t)random() << 16) ^ (uint32_t)random();
+}
+
+// --- Task ---
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(time_us_64() / 1000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return &dummy_task;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    (void)task;
+    notifications++;
+    if (higher_priority_task_woken)
+        *higher_priority_task_woken = pdTRUE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    vTaskNotifyGiveFromISR(task, NULL);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (notifications == 0)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (ticks_to_wait != portMAX_DELAY && elapsed >= ticks_to_wait)
+            return 0;
+        host_net_poll(ticks_to_wait == portMAX_DELAY ? 1000 : ticks_to_wait - elapsed);
+    }
+
+    uint32_t value = notifications;
+    notifications = clear_on_exit ? 0 : notifications - 1;
+    return value;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t elapsed;
+    while ((elapsed = xTaskGetTickCount() - start) < ticks)
+        host_net_poll(ticks - elapsed);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+    exit(EXIT_FAILURE); // only ever called by a task giving up
+}
+
+// --- Interrupts and PWM pulse counters ---
+
+_Thread_local uint32_t host_interrupts_masked;
+
+static struct
+{
+    bool enabled;
+    bool irq_enabled;
+    bool irq_pending;
+    uint16_t counter;
+    uint16_t wrap;
+} slices[NUM_PWM_SLICES];
+static irq_handler_t wrap_handler;
+static bool wrap_irq_enabled;
+static uint32_t wrap_irqs;
+static uint32_t (*pulse_source)(uint slice_num);
+
+void host_deliver_interrupts(void)
+{
+    if (host_interrupts_masked || !wrap_irq_enabled || !wrap_handler)
+        return;
+    while (pwm_get_irq_status_mask() != 0)
+    {
+        wrap_irqs++;
+        wrap_handler(); // clears the flag, or the interrupt would fire forever
+    }
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+    (void)order_priority;
+    if (num == PWM_IRQ_WRAP)
+        wrap_handler = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    if (num == PWM_IRQ_WRAP)
+        wrap_irq_enabled = enabled;
+    host_deliver_interrupts();
+}
+
+void pwm_init(uint slice_num, pwm_config *c, bool start)
+{
+    slices[slice_num].counter = 0;
+    slices[slice_num].wrap = c->wrap;
+    slices[slice_num].enabled = start;
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    slices[slice_num].enabled = enabled;
+}
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled)
+{
+    slices[slice_num].irq_enabled = enabled;
+}
+
+void pwm_clear_irq(uint slice_num)
+{
+    slices[slice_num].irq_pending = false;
+}
+
+uint32_t pwm_get_irq_status_mask(void)
+{
+    uint32_t mask = 0;
+    for (uint i = 0; i < NUM_PWM_SLICES; i++)
+    {
+        if (slices[i].irq_enabled && slices[i].irq_pending)
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+uint16_t pwm_get_counter(uint slice_num)
+{
+    if (pulse_source)
+        host_pwm_pulses(slice_num, pulse_source(slice_num));
+    return slices[slice_num].counter;
+}
+
+// A wrap while the flag is still set is lost, as in the hardware
+void host_pwm_pulses(uint slice_num, uint32_t pulses)
+{
+    if (!slices[slice_num].enabled)
+        return;
+
+    uint32_t period = (uint32_t)slices[slice_num].wrap + 1;
+    while (pulses > 0)
+    {
+        uint32_t to_wrap = period - slices[slice_num].counter;
+        if (pulses < to_wrap)
+        {
+            slices[slice_num].counter += (uint16_t)pulses;
+            break;
+        }
+        pulses -= to_wrap;
+        slices[slice_num].counter = 0;
+        slices[slice_num].irq_pending = true;
+        host_deliver_interrupts();
+    }
+}
+
+void host_pwm_set_source(uint32_t (*source)(uint slice_num))
+{
+    pulse_source = source;
+}
+
+uint32_t host_pwm_wrap_irqs(void)
+{
+    return wrap_irqs;
+}
+
+// --- altcp over sockets ---
+
+void pbuf_free(struct pbuf *p)
+{
+    free(p);
+}
+
+static void release(struct altcp_pcb *pcb)
+{
+#ifdef HOST_TLS
+    if (pcb->context.ssl)
+    {
+        // close_notify on a graceful close, as altcp_mbedtls sends it
+        if (pcb->closing && pcb->fd >= 0 && SSL_is_init_finished(pcb->context.ssl))
+            SSL_shutdown(pcb->context.ssl);
+        SSL_free(pcb->context.ssl);
+        pcb->context.ssl = NULL;
+    }
+#endif
+    if (pcb->fd >= 0)
+        close(pcb->fd);
+    pcb->fd = -1;
+    pcb->dead = true;
+}
+
+// Like lwIP, the pcb is gone when the err callback runs
+static void fail(struct altcp_pcb *pcb, err_t err)
+{
+    altcp_err_fn callback = pcb->err;
+    void *arg = pcb->arg;
+    release(pcb);
+    if (callback)
+        callback(arg, err);
+}
+
+struct altcp_pcb *altcp_tcp_new_ip_type(u8_t ip_type)
+{
+    (void)ip_type;
+    for (int i = 0; i < MAX_PCBS; i++)
+    {
+        if (pcbs[i] == NULL)
+        {
+            pcbs[i] = calloc(1, sizeof(struct altcp_pcb));
+            if (pcbs[i])
+                pcbs[i]->fd = -1;
+            return pcbs[i];
+        }
+    }
+    return NULL;
+}
+
+void altcp_arg(struct altcp_pcb *pcb, void *arg)
+{
+    pcb->arg = arg;
+}
+
+void altcp_recv(struct altcp_pcb *pcb, altcp_recv_fn recv)
+{
+    pcb->recv = recv;
+}
+
+void altcp_sent(struct altcp_pcb *pcb, altcp_sent_fn sent)
+{
+    pcb->sent = sent;
+}
+
+void altcp_err(struct altcp_pcb *pcb, altcp_err_fn err)
+{
+    pcb->err = err;
+}
+
+err_t altcp_connect(struct altcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port, altcp_connected_fn connected)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = ipaddr->addr };
+
+    pcb->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (pcb->fd < 0)
+        return ERR_MEM;
+    if (connect(pcb->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS)
+    {
+        close(pcb->fd);
+        pcb->fd = -1;
+        return ERR_RTE;
+    }
+#ifdef HOST_TLS
+    if (pcb->context.ssl)
+        SSL_set_fd(pcb->context.ssl, pcb->fd);
+#endif
+
+    pcb->connected = connected;
+    pcb->connecting = true;
+    return ERR_OK;
+}
+
+err_t altcp_write(struct altcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags)
+{
+    (void)apiflags;
+    if (pcb->fd < 0 || pcb->closing)
+        return ERR_CONN;
+    if (len > sizeof(pcb->queue) - pcb->queued)
+        return ERR_MEM;
+    if (pcb->tls && len > MBEDTLS_SSL_OUT_CONTENT_LEN)
+        return ERR_MEM; // altcp_mbedtls makes one record of each write and fails beyond that
+    memcpy(pcb->queue + pcb->queued, dataptr, len);
+    pcb->queued += len;
+    return ERR_OK;
+}
+
+err_t altcp_output(struct altcp_pcb *pcb)
+{
+    (void)pcb;
+    return ERR_OK; // flushed by the next poll
+}
+
+u16_t altcp_sndbuf(struct altcp_pcb *pcb)
+{
+    return (u16_t)(sizeof(pcb->queue) - pcb->queued);
+}
+
+void altcp_recved(struct altcp_pcb *pcb, u16_t len)
+{
+    (void)pcb;
+    (void)len;
+}
+
+err_t altcp_close(struct altcp_pcb *pcb)
+{
+    pcb->closing = true;
+    pcb->recv = NULL;
+    pcb->sent = NULL;
+    pcb->err = NULL;
+    if (pcb->queued == 0)
+        release(pcb);
+    return ERR_OK;
+}
+
+void altcp_abort(struct altcp_pcb *pcb)
+{
+    if (pcb->fd >= 0)
+    {
+        struct linger reset = { .l_onoff = 1, .l_linger = 0 }; // RST, as tcp_abort() sends
+        setsockopt(pcb->fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    }
+    fail(pcb, ERR_ABRT);
+}
+
+// Socket I/O, through OpenSSL on a TLS connection. Like send() and recv():
+// -1 with errno EAGAIN when it would block, 0 from pcb_recv() at EOF.
+#ifdef HOST_TLS
+static ssize_t tls_result(struct altcp_pcb *pcb, int n)
+{
+    switch (SSL_get_error(pcb->context.ssl, n))
+    {
+    case SSL_ERROR_NONE:
+        return n;
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return -1;
+    case SSL_ERROR_ZERO_RETURN:
+        return 0; // close_notify
+    default:
+        ERR_clear_error();
+        errno = ECONNRESET;
+        return -1;
+    }
+}
+#endif
+
+static ssize_t pcb_send(struct altcp_pcb *pcb, const void *data, size_t len)
+{
+#ifdef HOST_TLS
+    if (pcb->context.ssl)
+        return tls_result(pcb, SSL_write(pcb->context.ssl, data, (int)len));
+#endif
+    return send(pcb->fd, data, len, MSG_NOSIGNAL);
+}
+
+static ssize_t pcb_recv(struct altcp_pcb *pcb, void *data, size_t len)
+{
+#ifdef HOST_TLS
+    if (pcb->context.ssl)
+        return tls_result(pcb, SSL_read(pcb->context.ssl, data, (int)len));
+#endif
+    return recv(pcb->fd, data, len, 0);
+}
+
+// Decrypted bytes OpenSSL holds that poll() cannot see
+static bool pcb_pending(struct altcp_pcb *pcb)
+{
+#ifdef HOST_TLS
+    if (pcb->context.ssl)
+        return SSL_pending(pcb->context.ssl) > 0;
+#endif
+    (void)pcb;
+    return false;
+}
+
+static void handle_handshake(struct altcp_pcb *pcb)
+{
+#ifdef HOST_TLS
+    int ret = SSL_connect(pcb->context.ssl);
+    if (ret == 1)
+    {
+        pcb->handshaking = false;
+        if (pcb->connected)
+            pcb->connected(pcb->arg, pcb, ERR_OK);
+        return;
+    }
+
+    int error = SSL_get_error(pcb->context.ssl, ret);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE)
+    {
+        pcb->handshake_wants = error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT;
+        return;
+    }
+
+    long verify = SSL_get_verify_result(pcb->context.ssl);
+    printf("Host: TLS handshake failed: %s\n", verify != X509_V_OK ? X509_verify_cert_error_string(verify)
+                                                                   : ERR_reason_error_string(ERR_peek_last_error()));
+    ERR_clear_error();
+#endif
+    fail(pcb, ERR_CLSD); // as altcp_mbedtls reports a failed handshake
+}
+
+static void handle_connect(struct altcp_pcb *pcb)
+{
+    int error = 0;
+    socklen_t len = sizeof(error);
+    getsockopt(pcb->fd, SOL_SOCKET, SO_ERROR, &error, &len);
+    pcb->connecting = false;
+
+    if (error != 0)
+    {
+        fail(pcb, ERR_RST); // refused: lwIP reports it through err, not connected
+        return;
+    }
+    if (pcb->tls)
+    {
+        pcb->handshaking = true;
+        handle_handshake(pcb);
+        return;
+    }
+    if (pcb->connected)
+        pcb->connected(pcb->arg, pcb, ERR_OK);
+}
+
+static void handle_write(struct altcp_pcb *pcb)
+{
+    ssize_t n = pcb_send(pcb, pcb->queue, pcb->queued);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            fail(pcb, ERR_RST);
+        return;
+    }
+
+    memmove(pcb->queue, pcb->queue + n, pcb->queued - (size_t)n);
+    pcb->queued -= (size_t)n;
+    if (pcb->closing && pcb->queued == 0)
+        release(pcb);
+    else if (pcb->sent && n > 0)
+        pcb->sent(pcb->arg, pcb, (u16_t)n);
+}
+
+static void handle_read(struct altcp_pcb *pcb)
+{
+    struct pbuf *p = malloc(sizeof(struct pbuf) + RECV_CHUNK);
+    if (!p)
+        return;
+
+    ssize_t n = pcb_recv(pcb, (uint8_t *)(p + 1), RECV_CHUNK);
+    if (n < 0)
+    {
+        free(p);
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            fail(pcb, ERR_RST);
+        return;
+    }
+    if (n == 0)
+    {
+        free(p);
+        pcb->eof = true;
+        if (pcb->recv)
+            pcb->recv(pcb->arg, pcb, NULL, ERR_OK);
+        return;
+    }
+
+    p->next = NULL;
+    p->payload = p + 1;
+    p->tot_len = p->len = (u16_t)n;
+    if (pcb->recv)
+        pcb->recv(pcb->arg, pcb, p, ERR_OK);
+    else
+        pbuf_free(p);
+}
+
+void host_net_poll(uint32_t timeout_ms)
+{
+    struct pollfd fds[MAX_PCBS];
+    struct altcp_pcb *polled[MAX_PCBS];
+    int n = 0;
+
+    for (int i = 0; i < MAX_PCBS; i++)
+    {
+        struct altcp_pcb *pcb = pcbs[i];
+        if (pcb == NULL || pcb->fd < 0)
+            continue;
+        short events = 0;
+        if (pcb->handshaking)
+            events = pcb->handshake_wants;
+        else
+        {
+            if (pcb->connecting || pcb->queued > 0)
+                events |= POLLOUT;
+            if (!pcb->connecting && !pcb->eof && !pcb->closing)
+                events |= POLLIN;
+        }
+        fds[n] = (struct pollfd){ .fd = pcb->fd, .events = events };
+        polled[n++] = pcb;
+    }
+
+    if (n == 0)
+    {
+        usleep(timeout_ms * 1000);
+        return;
+    }
+    if (poll(fds, n, (int)timeout_ms) <= 0)
+        return;
+
+    for (int i = 0; i < n; i++)
+    {
+        struct altcp_pcb *pcb = polled[i];
+        short revents = fds[i].revents;
+
+        if (pcb->dead || revents == 0)
+            continue;
+        if (pcb->connecting)
+        {
+            handle_connect(pcb);
+            continue;
+        }
+        if (pcb->handshaking)
+        {
+            handle_handshake(pcb);
+            continue;
+        }
+        if ((revents & POLLOUT) && pcb->queued > 0)
+            handle_write(pcb);
+        if (!pcb->dead && (revents & (POLLIN | POLLHUP | POLLERR)) && !pcb->eof && !pcb->closing)
+        {
+            // A TLS record may hold more than one read takes: drain what OpenSSL buffered
+            do
+                handle_read(pcb);
+            while (!pcb->dead && !pcb->eof && !pcb->closing && pcb_pending(pcb));
+        }
+    }
+
+    // Callbacks are done with them
+    for (int i = 0; i < MAX_PCBS; i++)
+    {
+        if (pcbs[i] && pcbs[i]->dead)
+        {
+            free(pcbs[i]);
+            pcbs[i] = NULL;
+        }
+    }
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg)
+{
+    (void)found;
+    (void)callback_arg;
+
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *result;
+    if (getaddrinfo(hostname, NULL, &hints, &result) != 0)
+        return ERR_ARG;
+
+    addr->addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(result);
+    return ERR_OK;
+}
+
+// --- TLS on OpenSSL ---
+
+#ifdef HOST_TLS
+
+// Every CA certificate of a PEM bundle, as mbedtls_x509_crt_parse() takes them
+static bool load_ca(SSL_CTX *ctx, const u8_t *ca, size_t ca_len)
+{
+    BIO *bio = BIO_new_mem_buf(ca, (int)ca_len);
+    X509_STORE *store = SSL_CTX_get_cert_store(ctx);
+    X509 *cert;
+    int count = 0;
+
+    while ((cert = PEM_read_bio_X509(bio, NULL, NULL, NULL)) != NULL)
+    {
+        if (X509_STORE_add_cert(store, cert) == 1)
+            count++;
+        X509_free(cert);
+    }
+    ERR_clear_error(); // end of the bundle
+    BIO_free(bio);
+    return count > 0;
+}
+
+struct altcp_tls_config *altcp_tls_create_config_client(const u8_t *ca, size_t ca_len)
+{
+    struct altcp_tls_config *config = calloc(1, sizeof(*config));
+    if (!config)
+        return NULL;
+
+    // TLS 1.2 only, as the firmware's mbedTLS, so resumption works the same way (tickets or IDs)
+    config->ctx = SSL_CTX_new(TLS_client_method());
+    if (!config->ctx || !SSL_CTX_set_min_proto_version(config->ctx, TLS1_2_VERSION) ||
+        !SSL_CTX_set_max_proto_version(config->ctx, TLS1_2_VERSION))
+        goto failed;
+    SSL_CTX_set_mode(config->ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+    if (ca)
+    {
+        if (!load_ca(config->ctx, ca, ca_len))
+            goto failed;
+        SSL_CTX_set_verify(config->ctx, SSL_VERIFY_PEER, NULL);
+    }
+    else
+    {
+        SSL_CTX_set_verify(config->ctx, SSL_VERIFY_NONE, NULL);
+    }
+    return config;
+
+failed:
+    SSL_CTX_free(config->ctx);
+    free(config);
+    return NULL;
+}
+
+struct altcp_pcb *altcp_tls_new(struct altcp_tls_config *config, u8_t ip_type)
+{
+    struct altcp_pcb *pcb = altcp_tcp_new_ip_type(ip_type);
+    if (!pcb)
+        return NULL;
+
+    pcb->context.ssl = SSL_new(config->ctx);
+    if (!pcb->context.ssl)
+    {
+        release(pcb);
+        return NULL;
+    }
+    if (config->conf.mfl_code != MBEDTLS_SSL_MAX_FRAG_LEN_NONE)
+        SSL_set_tlsext_max_fragment_length(pcb->context.ssl, config->conf.mfl_code);
+    pcb->tls = config;
+    return pcb;
+}
+
+void *altcp_tls_context(struct altcp_pcb *conn)
+{
+    return &conn->context;
+}
+
+struct altcp_tls_session *altcp_tls_alloc_session(void)
+{
+    return calloc(1, sizeof(struct altcp_tls_session));
+}
+
+err_t altcp_tls_get_session(struct altcp_pcb *conn, struct altcp_tls_session *session)
+{
+    SSL_SESSION *current = conn->context.ssl ? SSL_get1_session(conn->context.ssl) : NULL;
+    if (!current)
+        return ERR_VAL;
+    SSL_SESSION_free(session->session);
+    session->session = current;
+    return ERR_OK;
+}
+
+err_t altcp_tls_set_session(struct altcp_pcb *conn, struct altcp_tls_session *session)
+{
+    if (!session->session || !SSL_set_session(conn->context.ssl, session->session))
+        return ERR_VAL;
+    return ERR_OK;
+}
+
+// SNI, and the name the server certificate must be valid for
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname)
+{
+    if (!SSL_set_tlsext_host_name(ssl->ssl, hostname) || !SSL_set1_host(ssl->ssl, hostname))
+        return -1;
+    return 0;
+}
+
+#else // No TLS in this host build
+
+struct altcp_tls_config *altcp_tls_create_config_client(const u8_t *ca, size_t ca_len)
+{
+    (void)ca;
+    (void)ca_len;
+    printf("Host: built without OpenSSL, TLS is not available\n");
+    return NULL;
+}
+
+struct altcp_pcb *altcp_tls_new(struct altcp_tls_config *config, u8_t ip_type)
+{
+    (void)config;
+    (void)ip_type;
+    return NULL;
+}
+
+void *altcp_tls_context(struct altcp_pcb *conn)
+{
+    return &conn->context;
+}
+
+struct altcp_tls_session *altcp_tls_alloc_session(void)
+{
+    return NULL;
+}
+
+err_t altcp_tls_get_session(struct altcp_pcb *conn, struct altcp_tls_session *session)
+{
+    (void)conn;
+    (void)session;
+    return ERR_VAL;
+}
+
+err_t altcp_tls_set_session(struct altcp_pcb *conn, struct altcp_tls_session *session)
+{
+    (void)conn;
+    (void)session;
+    return ERR_VAL;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname)
+{
+    (void)ssl;
+    (void)hostname;
+    return 0;
+}
+
+#endif // HOST_TLS
+
+int mbedtls_ssl_conf_max_frag_len(mbedtls_ssl_config *conf, unsigned char mfl_code)
+{
+    conf->mfl_code = mfl_code;
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file altcp.h
+ * @brief Host stand-in for the part of lwIP's altcp API used by http_client.c,
+ * on top of non-blocking POSIX sockets.
+ *
+ * Callbacks keep lwIP's raw API semantics (connected, recv with a NULL pbuf
+ * at EOF, sent, err) and run from ulTaskNotifyTake()/vTaskDelay(), the way
+ * they run in the background IRQ on the board. Differences worth knowing:
+ * writes are always copied, and "sent" reports bytes handed to the kernel
+ * (or to OpenSSL, on a TLS connection) rather than bytes acked by the peer.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef LWIP_ALTCP_H
+#define LWIP_ALTCP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_BUF -2
+#define ERR_TIMEOUT -3
+#define ERR_RTE -4
+#define ERR_INPROGRESS -5
+#define ERR_VAL -6
+#define ERR_WOULDBLOCK -7
+#define ERR_USE -8
+#define ERR_ALREADY -9
+#define ERR_ISCONN -10
+#define ERR_CONN -11
+#define ERR_IF -12
+#define ERR_ABRT -13
+#define ERR_RST -14
+#define ERR_CLSD -15
+#define ERR_ARG -16
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+#define TCP_MSS 1460
+#define TCP_SND_BUF (2 * TCP_MSS) // lwIP default, also what the board runs with
+
+#define IPADDR_TYPE_V4 0
+#define IPADDR_TYPE_ANY 46
+
+typedef struct
+{
+    uint32_t addr; // IPv4, network order
+} ip_addr_t;
+
+struct pbuf
+{
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+void pbuf_free(struct pbuf *p);
+
+struct altcp_pcb;
+
+typedef err_t (*altcp_connected_fn)(void *arg, struct altcp_pcb *pcb, err_t err);
+typedef err_t (*altcp_recv_fn)(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err);
+typedef err_t (*altcp_sent_fn)(void *arg, struct altcp_pcb *pcb, u16_t len);
+typedef void (*altcp_err_fn)(void *arg, err_t err);
+
+struct altcp_pcb *altcp_tcp_new_ip_type(u8_t ip_type);
+void altcp_arg(struct altcp_pcb *pcb, void *arg);
+void altcp_recv(struct altcp_pcb *pcb, altcp_recv_fn recv);
+void altcp_sent(struct altcp_pcb *pcb, altcp_sent_fn sent);
+void altcp_err(struct altcp_pcb *pcb, altcp_err_fn err);
+err_t altcp_connect(struct altcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port, altcp_connected_fn connected);
+err_t altcp_write(struct altcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t altcp_output(struct altcp_pcb *pcb);
+u16_t altcp_sndbuf(struct altcp_pcb *pcb);
+void altcp_recved(struct altcp_pcb *pcb, u16_t len);
+err_t altcp_close(struct altcp_pcb *pcb);
+void altcp_abort(struct altcp_pcb *pcb);
+
+/**
+ * @brief Waits up to timeout_ms for socket events and runs their callbacks.
+ */
+void host_net_poll(uint32_t timeout_ms);
+
+#endif // LWIP_ALTCP_H
@@ -0,0 +1,30 @@
+/**
+ * @file altcp_tls.h
+ * @brief Host stand-in for altcp_tls, on OpenSSL in place of mbedTLS. Client
+ * only, TLS 1.2 only like src/mbedtls_config.h. Without OpenSSL in the host
+ * build, configs cannot be created and https:// requests fail.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef LWIP_ALTCP_TLS_H
+#define LWIP_ALTCP_TLS_H
+
+#include "lwip/altcp.h"
+
+struct altcp_tls_config;
+struct altcp_tls_session;
+
+/**
+ * @param ca PEM CA certificates the server must chain to, or NULL to skip verification.
+ */
+struct altcp_tls_config *altcp_tls_create_config_client(const u8_t *ca, size_t ca_len);
+struct altcp_pcb *altcp_tls_new(struct altcp_tls_config *config, u8_t ip_type);
+void *altcp_tls_context(struct altcp_pcb *conn);
+struct altcp_tls_session *altcp_tls_alloc_session(void);
+err_t altcp_tls_get_session(struct altcp_pcb *conn, struct altcp_tls_session *session);
+err_t altcp_tls_set_session(struct altcp_pcb *conn, struct altcp_tls_session *session);
+
+#endif // LWIP_ALTCP_TLS_H
@@ -0,0 +1,20 @@
+/**
+ * @file dns.h
+ * @brief Host stand-in for lwIP DNS: lookups are resolved synchronously with
+ * getaddrinfo(), so the callback is never used.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef LWIP_DNS_H
+#define LWIP_DNS_H
+
+#include "lwip/altcp.h"
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);
+
+#endif // LWIP_DNS_H
@@ -0,0 +1,10 @@
+/**
+ * @file tcp.h
+ * @brief Host stand-in: everything http_client.c needs is in altcp.h.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "lwip/altcp.h"
@@ -0,0 +1,38 @@
+/**
+ * @file ssl.h
+ * @brief Host stand-in for the few mbedTLS calls made by http_client.c.
+ * Behind them is the OpenSSL connection of the host altcp_tls (see
+ * host_port.c), or nothing when the host build has no OpenSSL.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef MBEDTLS_SSL_H
+#define MBEDTLS_SSL_H
+
+#include "mbedtls_config.h"
+
+#define MBEDTLS_SSL_VERIFY_NONE 0
+#define MBEDTLS_SSL_VERIFY_OPTIONAL 1
+#define MBEDTLS_SSL_VERIFY_REQUIRED 2
+
+// Same codes as the max_fragment_length extension of RFC 6066
+#define MBEDTLS_SSL_MAX_FRAG_LEN_NONE 0
+#define MBEDTLS_SSL_MAX_FRAG_LEN_4096 4
+
+typedef struct mbedtls_ssl_config
+{
+    unsigned char mfl_code; // MBEDTLS_SSL_MAX_FRAG_LEN_..., asked on every connection
+} mbedtls_ssl_config;
+
+typedef struct
+{
+    struct ssl_st *ssl; // OpenSSL's SSL
+} mbedtls_ssl_context;
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname);
+int mbedtls_ssl_conf_max_frag_len(mbedtls_ssl_config *conf, unsigned char mfl_code);
+
+#endif // MBEDTLS_SSL_H
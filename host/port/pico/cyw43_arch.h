@@ -0,0 +1,22 @@
+/**
+ * @file cyw43_arch.h
+ * @brief Host stand-in for the lwIP lock of pico_cyw43_arch: callbacks already
+ * run on the only thread, so there is nothing to take.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef PICO_CYW43_ARCH_H
+#define PICO_CYW43_ARCH_H
+
+static inline void cyw43_arch_lwip_begin(void)
+{
+}
+
+static inline void cyw43_arch_lwip_end(void)
+{
+}
+
+#endif // PICO_CYW43_ARCH_H
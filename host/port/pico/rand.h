@@ -0,0 +1,17 @@
+/**
+ * @file rand.h
+ * @brief Host stand-in for pico_rand.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef PICO_RAND_H
+#define PICO_RAND_H
+
+#include <stdint.h>
+
+uint32_t get_rand_32(void);
+
+#endif // PICO_RAND_H
@@ -0,0 +1,30 @@
+/**
+ * @file stdlib.h
+ * @brief Host stand-in for pico/stdlib.h: the GPIO calls of the pulse counter.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef PICO_STDLIB_H
+#define PICO_STDLIB_H
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define GPIO_FUNC_PWM 4
+
+static inline void gpio_set_function(uint gpio, uint fn)
+{
+    (void)gpio;
+    (void)fn;
+}
+
+static inline void gpio_pull_up(uint gpio)
+{
+    (void)gpio;
+}
+
+#endif // PICO_STDLIB_H
@@ -0,0 +1,26 @@
+/**
+ * @file datetime.h
+ * @brief Host copy of the Pico SDK datetime_t.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef PICO_UTIL_DATETIME_H
+#define PICO_UTIL_DATETIME_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    int16_t year;  // 0..4095
+    int8_t month;  // 1..12
+    int8_t day;    // 1..31
+    int8_t dotw;   // 0..6, 0 is Sunday
+    int8_t hour;   // 0..23
+    int8_t min;    // 0..59
+    int8_t sec;    // 0..59
+} datetime_t;
+
+#endif // PICO_UTIL_DATETIME_H
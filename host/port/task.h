@@ -0,0 +1,38 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for the FreeRTOS task API: one task, notifications and ticks.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+/**
+ * @brief Waits for a notification, running lwIP callbacks meanwhile.
+ */
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+/**
+ * @brief Sleeps, running lwIP callbacks meanwhile.
+ */
+void vTaskDelay(TickType_t ticks);
+
+/**
+ * @brief Ends the process (the only task).
+ */
+void vTaskDelete(TaskHandle_t task);
+
+#endif // TASK_H
@@ -0,0 +1,206 @@
+/**
+ * @file schedule_bench.c
+ * @brief Lookup cost of the schedule store as it grows.
+ *
+ * Fills stores of 4 to SCHEDULE_MAX_ENTRIES random entries and times
+ * schedule_store_due() and schedule_store_minutes_to_next() at every minute
+ * of a week, next to a plain scan over the entries for comparison. Every
+ * answer is also checked against that scan.
+ *
+ * Fails if a lookup is wrong or if the indexed lookups at the largest size
+ * cost more than SLOWDOWN_LIMIT times what they cost at the smallest.
+ *
+ * Also reports the worst case of schedule_store_set() (a full index, every
+ * start of an entry moving from the end of the week to the start) and of the
+ * store copy irrigator_set_schedule() prepares it in. Reported, not judged.
+ *
+ * Usage: schedule_bench [repetitions]
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "schedule.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SLOWDOWN_LIMIT 4.0 // log2(256) / log2(4) for a binary search
+#define START_DATE 9497    // 2026-01-01, days since 2000-01-01
+
+static const int sizes[] = {4, 16, 64, 128, SCHEDULE_MAX_ENTRIES};
+#define SIZE_COUNT (int)(sizeof(sizes) / sizeof(sizes[0]))
+
+static schedule_store_t store;
+static int entry_count;
+static volatile int32_t sink; // keeps the timed calls from being optimized out
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fill(int count)
+{
+    schedule_store_init(&store);
+    entry_count = count;
+    for (int i = 0; i < count; i++)
+    {
+        schedule_item_t item = {
+            .hour = (uint8_t)(rand() % 24),
+            .minute = (uint8_t)(rand() % 60),
+            .duration = 60,
+            .active = 1,
+            .zone = 0,
+            .days = (uint8_t)(rand() % SCHEDULE_EVERY_DAY + 1),
+        };
+        schedule_store_set(&store, i, &item);
+    }
+}
+
+// Reference answers: every entry, every day it runs
+static int scan_due(const datetime_t *t)
+{
+    int count = 0;
+    for (int i = 0; i < entry_count; i++)
+    {
+        const schedule_item_t *item = &store.entries[i];
+        if (item->active && (item->days & (1 << t->dotw)) && item->hour == t->hour && item->minute == t->min)
+            count++;
+    }
+    return count;
+}
+
+static int32_t scan_minutes_to_next(const datetime_t *t)
+{
+    int now = t->dotw * 24 * 60 + t->hour * 60 + t->min;
+    int32_t best = -1;
+    for (int i = 0; i < entry_count; i++)
+    {
+        const schedule_item_t *item = &store.entries[i];
+        for (int d = 0; item->active && d < 7; d++)
+        {
+            if (!(item->days & (1 << d)))
+                continue;
+            int32_t delta = (d * 24 * 60 + item->hour * 60 + item->minute - now + SCHEDULE_MINUTES_PER_WEEK) % SCHEDULE_MINUTES_PER_WEEK;
+            if (best < 0 || delta < best)
+                best = delta;
+        }
+    }
+    return best;
+}
+
+static bool check(void)
+{
+    uint16_t due[SCHEDULE_MAX_ENTRIES];
+    uint32_t first = (uint32_t)START_DATE * 24 * 60;
+
+    for (uint32_t m = first; m < first + SCHEDULE_MINUTES_PER_WEEK; m++)
+    {
+        datetime_t t;
+        schedule_date_of(m, &t);
+        int got = schedule_store_due(&store, &t, due, SCHEDULE_MAX_ENTRIES);
+        int32_t next = schedule_store_minutes_to_next(&store, &t, false);
+        if (got != scan_due(&t) || next != scan_minutes_to_next(&t))
+        {
+            printf("FAIL: %d entries, %02d:%02d dotw %d: due %d/%d, next %ld/%ld\n", entry_count, t.hour, t.min, t.dotw,
+                   got, scan_due(&t), (long)next, (long)scan_minutes_to_next(&t));
+            return false;
+        }
+    }
+    return true;
+}
+
+// Nanoseconds per lookup (due + next) over a week of minutes
+static double time_lookups(int reps, bool indexed)
+{
+    static datetime_t week[SCHEDULE_MINUTES_PER_WEEK];
+    uint16_t due[SCHEDULE_MAX_ENTRIES];
+
+    for (int m = 0; m < SCHEDULE_MINUTES_PER_WEEK; m++)
+        schedule_date_of((uint32_t)START_DATE * 24 * 60 + m, &week[m]);
+
+    double start = now_ns();
+    for (int r = 0; r < reps; r++)
+    {
+        for (int m = 0; m < SCHEDULE_MINUTES_PER_WEEK; m++)
+        {
+            if (indexed)
+                sink += schedule_store_due(&store, &week[m], due, SCHEDULE_MAX_ENTRIES) +
+                        schedule_store_minutes_to_next(&store, &week[m], true);
+            else
+                sink += scan_due(&week[m]) + scan_minutes_to_next(&week[m]);
+        }
+    }
+    return (now_ns() - start) / ((double)reps * SCHEDULE_MINUTES_PER_WEEK);
+}
+
+// Microseconds per update of a store where every entry starts every day
+static void time_worst_set(int reps)
+{
+    static schedule_store_t copy;
+    schedule_store_t *volatile to = &copy; // an opaque destination, so the copy is not optimized out
+    schedule_item_t item = {.duration = 60, .active = 1, .days = SCHEDULE_EVERY_DAY};
+
+    schedule_store_init(&store);
+    for (int i = 0; i < SCHEDULE_MAX_ENTRIES; i++)
+    {
+        item.hour = (uint8_t)(i % 24);
+        schedule_store_set(&store, i, &item);
+    }
+
+    double start = now_ns();
+    for (int r = 0; r < reps; r++)
+    {
+        item.hour = r % 2 ? 23 : 0;
+        item.minute = r % 2 ? 59 : 0;
+        schedule_store_set(&store, SCHEDULE_MAX_ENTRIES - 1, &item);
+    }
+    double set_us = (now_ns() - start) / reps / 1e3;
+
+    start = now_ns();
+    for (int r = 0; r < reps; r++)
+    {
+        memcpy(to, &store, sizeof(copy));
+    }
+    double copy_us = (now_ns() - start) / reps / 1e3;
+
+    printf("Worst update, %d starts: %.2f us, plus %.2f us to copy the %u B store\n", store.index_len, set_us, copy_us,
+           (unsigned)sizeof(store));
+}
+
+int main(int argc, char **argv)
+{
+    int reps = argc > 1 ? atoi(argv[1]) : 50;
+    double indexed_ns[SIZE_COUNT];
+
+    srand(1);
+    printf("%8s %8s %14s %14s\n", "entries", "starts", "indexed ns", "scan ns");
+    for (int s = 0; s < SIZE_COUNT; s++)
+    {
+        fill(sizes[s]);
+        if (!check())
+            return EXIT_FAILURE;
+
+        // Best of three, to keep scheduler noise out of the comparison
+        indexed_ns[s] = time_lookups(reps, true);
+        for (int k = 0; k < 2; k++)
+        {
+            double ns = time_lookups(reps, true);
+            if (ns < indexed_ns[s])
+                indexed_ns[s] = ns;
+        }
+        double scan_ns = time_lookups(reps / 10 + 1, false);
+        printf("%8d %8d %14.1f %14.1f\n", sizes[s], store.index_len, indexed_ns[s], scan_ns);
+    }
+
+    time_worst_set(reps * 20);
+
+    double slowdown = indexed_ns[SIZE_COUNT - 1] / indexed_ns[0];
+    printf("Indexed lookup, %d vs %d entries: %.2fx (limit %.1fx)\n", sizes[SIZE_COUNT - 1], sizes[0], slowdown, SLOWDOWN_LIMIT);
+    return slowdown <= SLOWDOWN_LIMIT ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file seqlock_stress.c
+ * @brief Stress test of seqlock.c with host threads.
+ *
+ * One writer publishes records whose words all hold the same counter, the
+ * way aht10.c publishes a reading, and edits a schedule store the way
+ * irrigator_set_schedule() does: in a copy that is not published, which
+ * then replaces the published one under the seqlock and is reused for the
+ * edit after next. Reader threads take snapshots of both,
+ * like the irrigator task and the lwIP callbacks, and count any torn one:
+ * a record with mixed counters, a counter going back, or an entry whose
+ * fields disagree.
+ *
+ * The same readers first run against unprotected copies for comparison, to
+ * show the test catches tearing at all. That pass is reported, not judged.
+ *
+ * Usage: seqlock_stress [seconds] [readers]
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "schedule.h"
+#include "seqlock.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RECORD_WORDS 16
+#define MAX_READERS 16
+
+typedef struct
+{
+    uint32_t word[RECORD_WORDS];
+} record_t;
+
+typedef struct
+{
+    uint64_t reads;
+    uint64_t retries;
+    uint64_t torn;
+} reader_stats_t;
+
+static seqlock_t record_lock = SEQLOCK_INIT;
+static record_t record;
+static seqlock_t store_lock = SEQLOCK_INIT;
+static schedule_store_t stores[2];
+static schedule_store_t *volatile store = &stores[0]; // published
+
+static bool locked;
+static atomic_bool running;
+static uint64_t writes;
+
+static void write_record(const record_t *value)
+{
+    if (locked)
+    {
+        seqlock_write(&record_lock, &record, value, sizeof(record));
+    }
+    else
+    {
+        for (int i = 0; i < RECORD_WORDS; i++)
+            ((volatile uint32_t *)record.word)[i] = value->word[i];
+    }
+}
+
+// Entry fields are all derived from n, so a mix of two writes shows
+static void write_entry(uint32_t n)
+{
+    schedule_item_t item = {
+        .hour = (uint8_t)(n % 24),
+        .minute = (uint8_t)(n % 24),
+        .duration = (uint16_t)(n % 24),
+        .active = 1,
+        .days = SCHEDULE_EVERY_DAY,
+    };
+    int index = (int)(n % SCHEDULE_MAX_ENTRIES);
+
+    if (!locked)
+    {
+        schedule_store_set(store, index, &item);
+        return;
+    }
+
+    schedule_store_t *next = store == &stores[0] ? &stores[1] : &stores[0];
+    memcpy(next, store, sizeof(*next));
+    schedule_store_set(next, index, &item);
+    uint32_t saved = seqlock_write_begin(&store_lock);
+    store = next;
+    seqlock_write_end(&store_lock, saved);
+}
+
+static void *writer(void *arg)
+{
+    (void)arg;
+    record_t value;
+
+    for (uint32_t n = 1; atomic_load(&running); n++)
+    {
+        for (int i = 0; i < RECORD_WORDS; i++)
+            value.word[i] = n;
+        write_record(&value);
+        write_entry(n);
+        writes++;
+    }
+    return NULL;
+}
+
+static bool record_torn(const record_t *r, uint32_t *last)
+{
+    for (int i = 1; i < RECORD_WORDS; i++)
+    {
+        if (r->word[i] != r->word[0])
+            return true;
+    }
+    if (r->word[0] < *last)
+        return true;
+    *last = r->word[0];
+    return false;
+}
+
+// The controller reads an entry and the index around it, as read_due() does
+static bool entry_torn(int index)
+{
+    const schedule_store_t *published = store;
+    const schedule_item_t *item = &published->entries[index];
+    uint8_t hour = item->hour;
+    uint8_t minute = item->minute;
+    uint16_t duration = item->duration;
+    int len = published->index_len;
+
+    return (item->days != 0 && (hour != minute || hour != duration)) || len < 0 || len > SCHEDULE_MAX_ENTRIES * 7;
+}
+
+static void *reader(void *arg)
+{
+    reader_stats_t *stats = arg;
+    uint32_t last = 0;
+    record_t copy;
+
+    for (int index = 0; atomic_load(&running); index = (index + 1) % SCHEDULE_MAX_ENTRIES)
+    {
+        bool torn;
+        if (locked)
+        {
+            uint32_t seq;
+            stats->retries--;
+            do
+            {
+                stats->retries++;
+                seq = seqlock_read_begin(&record_lock);
+                memcpy(&copy, &record, sizeof(copy));
+            } while (seqlock_read_retry(&record_lock, seq));
+            torn = record_torn(&copy, &last);
+
+            bool entry;
+            stats->retries--;
+            do
+            {
+                stats->retries++;
+                seq = seqlock_read_begin(&store_lock);
+                entry = entry_torn(index);
+            } while (seqlock_read_retry(&store_lock, seq));
+            torn |= entry;
+        }
+        else
+        {
+            for (int i = 0; i < RECORD_WORDS; i++)
+                copy.word[i] = ((volatile uint32_t *)record.word)[i];
+            torn = record_torn(&copy, &last) | entry_torn(index);
+        }
+
+        stats->reads++;
+        if (torn)
+            stats->torn++;
+    }
+    return NULL;
+}
+
+static reader_stats_t run(bool with_lock, double seconds, int readers)
+{
+    pthread_t threads[MAX_READERS + 1];
+    reader_stats_t stats[MAX_READERS] = {0};
+    reader_stats_t total = {0};
+
+    locked = with_lock;
+    writes = 0;
+    memset(&record, 0, sizeof(record));
+    schedule_store_init(&stores[0]);
+    schedule_store_init(&stores[1]);
+    store = &stores[0];
+    atomic_store(&running, true);
+
+    pthread_create(&threads[0], NULL, writer, NULL);
+    for (int i = 0; i < readers; i++)
+        pthread_create(&threads[i + 1], NULL, reader, &stats[i]);
+
+    usleep((useconds_t)(seconds * 1e6));
+    atomic_store(&running, false);
+    for (int i = 0; i <= readers; i++)
+        pthread_join(threads[i], NULL);
+
+    for (int i = 0; i < readers; i++)
+    {
+        total.reads += stats[i].reads;
+        total.retries += stats[i].retries;
+        total.torn += stats[i].torn;
+    }
+    printf("%-10s %12llu writes %12llu reads %10llu retries %10llu torn\n", with_lock ? "seqlock" : "no lock",
+           (unsigned long long)writes, (unsigned long long)total.reads, (unsigned long long)total.retries,
+           (unsigned long long)total.torn);
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int readers = argc > 2 ? atoi(argv[2]) : 3;
+    if (readers < 1 || readers > MAX_READERS)
+        readers = 3;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    run(false, seconds / 4, readers);
+    reader_stats_t result = run(true, seconds, readers);
+
+    if (result.torn > 0 || result.reads == 0)
+    {
+        printf("FAIL: torn snapshots through the seqlock\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Runs the host build of the global API client against mock_cloud for a few
+# seconds and prints its per-cycle stats (time, requests, bytes, allocations).
+#
+#   sync_bench.sh <mock_cloud> <api_global_host> [port] [seconds] [mock options...]
+#
+# Fails unless the client logged in and completed at least one cycle.
+set -e
+
+mock=$1
+client=$2
+port=${3:-18080}
+seconds=${4:-12}
+if [ $# -ge 4 ]; then shift 4; else shift $#; fi
+
+"$mock" -p "$port" -w 2000 -k 3 -s 16 -c "$@" > mock.log 2>&1 &
+mock_pid=$!
+trap 'kill $mock_pid 2>/dev/null || true' EXIT
+sleep 0.3
+
+"$client" "$seconds" > client.log 2>&1 || true
+kill -INT $mock_pid
+wait $mock_pid 2>/dev/null || true
+
+grep "API Global: Cycle" client.log
+tail -n 1 mock.log
+grep -q "Token acquired" client.log
+grep -q "API Global: Cycle" client.log
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Makes the throwaway certificates of the TLS test in <dir>:
+#   ca.pem                      test CA, built into api_global_tls_host as API_TLS_CA_CERT
+#   server.pem, server.key      mock_cloud's certificate for localhost, signed by the CA
+#   rogue.pem, rogue.key        a self-signed one for localhost, which the client must refuse
+#
+#   tls_certs.sh <openssl> <dir>
+#
+# EC P-256 keys, which the firmware's mbedTLS config supports too.
+set -e
+
+openssl=$1
+dir=$2
+mkdir -p "$dir"
+cd "$dir"
+
+"$openssl" req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes -days 3650 \
+    -subj "/CN=Irrigation host test CA" -keyout ca.key -out ca.pem 2>/dev/null
+
+"$openssl" req -new -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes \
+    -subj "/CN=localhost" -keyout server.key -out server.csr 2>/dev/null
+printf 'subjectAltName=DNS:localhost,IP:127.0.0.1\n' > server.ext
+"$openssl" x509 -req -in server.csr -CA ca.pem -CAkey ca.key -CAcreateserial -days 3650 \
+    -extfile server.ext -out server.pem 2>/dev/null
+
+"$openssl" req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes -days 3650 \
+    -subj "/CN=localhost" -addext "subjectAltName=DNS:localhost" -keyout rogue.key -out rogue.pem 2>/dev/null
+
+rm -f server.csr server.ext ca.srl
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Runs the TLS build of the global API client against mock_cloud serving TLS
+# with a certificate from the test CA, then against a self-signed one.
+#
+#   tls_check.sh <mock_cloud> <api_global_tls_host> <port> <cert dir> [seconds]
+#
+# Fails unless the first handshake is a full one that asks for 4 KB records,
+# a later one resumes the saved session, and the client logs in and
+# completes a cycle over TLS. Also fails if the client gets through to the
+# server with the self-signed certificate, which does not chain to the CA
+# built into it.
+set -e
+
+mock=$1
+client=$2
+port=$3
+certs=$4
+seconds=${5:-12}
+
+"$mock" -p "$port" -w 1000 -C "$certs/server.pem" -K "$certs/server.key" > tls_mock.log 2>&1 &
+mock_pid=$!
+trap 'kill $mock_pid 2>/dev/null || true' EXIT
+sleep 0.3
+
+"$client" "$seconds" > tls_client.log 2>&1 || true
+kill -INT $mock_pid
+wait $mock_pid 2>/dev/null || true
+
+grep "Mock: TLS" tls_mock.log | head -n 3
+grep "API Global: TLS" tls_client.log | head -n 3
+grep "Mock: TLS" tls_mock.log | head -n 1 | grep -q "full handshake"
+grep "Mock: TLS" tls_mock.log | head -n 1 | grep -q "records up to 4096 B"
+grep -q "Mock: TLS resumed handshake" tls_mock.log
+! grep -q "Mock: TLS handshake failed" tls_mock.log
+grep -q "Token acquired" tls_client.log
+grep -q "API Global: Cycle" tls_client.log
+
+# A server the CA did not sign: no request may get through
+"$mock" -p "$port" -C "$certs/rogue.pem" -K "$certs/rogue.key" > tls_rogue_mock.log 2>&1 &
+mock_pid=$!
+sleep 0.3
+
+"$client" 3 > tls_rogue_client.log 2>&1 || true
+kill -INT $mock_pid
+wait $mock_pid 2>/dev/null || true
+
+grep "Host: TLS handshake failed" tls_rogue_client.log | head -n 1
+grep -q "Host: TLS handshake failed" tls_rogue_client.log
+! grep -q "Mock: POST\|Mock: GET" tls_rogue_mock.log
+! grep -q "Token acquired" tls_rogue_client.log
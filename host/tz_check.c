@@ -0,0 +1,84 @@
+/**
+ * @file tz_check.c
+ * @brief Checks the zone rules of tz.c against the C library.
+ *
+ * Built once per zone (TZ_ZONE) and given the POSIX TZ string with the same
+ * rule, which glibc evaluates without the tz database. From 2020 to 2037 it
+ * compares the offset every hour and at each change tz_seconds_to_next_change()
+ * announces (which must be exactly where the library's offset changes), and
+ * checks that tz_local_to_utc() maps every local time back to one that shows it.
+ *
+ * Usage: tz_check <POSIX TZ>, e.g. tz_check "CET-1CEST,M3.5.0,M10.5.0/3"
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#define _DEFAULT_SOURCE
+#include "tz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define FIRST_S 1577836800LL // 2020-01-01 00:00 UTC
+#define LAST_S 2145916800LL  // 2038-01-01 00:00 UTC
+
+static long libc_offset(int64_t utc_s)
+{
+    time_t t = (time_t)utc_s;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return tm.tm_gmtoff;
+}
+
+static bool same_offset(int64_t utc_s)
+{
+    if (tz_offset_at(utc_s) == libc_offset(utc_s))
+        return true;
+    printf("FAIL: %s at %lld: offset %ld, expected %ld\n", tz_rule()->name, (long long)utc_s, (long)tz_offset_at(utc_s),
+           libc_offset(utc_s));
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <POSIX TZ>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    setenv("TZ", argv[1], 1);
+    tzset();
+
+    int changes = 0;
+    for (int64_t t = FIRST_S; t < LAST_S; t += 3600)
+    {
+        if (!same_offset(t))
+            return EXIT_FAILURE;
+
+        int64_t local = t + tz_offset_at(t);
+        int64_t back = tz_local_to_utc(local);
+        if (back + tz_offset_at(back) != local)
+        {
+            printf("FAIL: %s: local %lld maps to %lld\n", tz_rule()->name, (long long)local, (long long)back);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (int64_t t = FIRST_S;; changes++)
+    {
+        int64_t to_next = tz_seconds_to_next_change(t);
+        if (to_next < 0 || t + to_next >= LAST_S)
+            break;
+        t += to_next;
+        if (!same_offset(t - 1) || !same_offset(t) || libc_offset(t - 1) == libc_offset(t))
+        {
+            printf("FAIL: %s: no offset change at %lld\n", tz_rule()->name, (long long)t);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%s (%s): offsets match 2020-2037, %d changes\n", tz_rule()->name, argv[1], changes);
+    return EXIT_SUCCESS;
+}
@@ -1,14 +1,24 @@
 #include "aht10.h"
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
+#include "i2c_async.h"
+#include "seqlock.h"
 #include <stdio.h>
 
-static float latest_temp = 0.0f;
-static float latest_hum = 0.0f;
+// Published together so a reader never pairs a new temperature with an old humidity
+typedef struct {
+    int32_t temp; // centésimos de °C
+    int32_t hum;  // centésimos de %
+} aht10_reading_t;
 
-void aht10_get_latest_readings(float *temp, float *hum) {
-    *temp = latest_temp;
-    *hum = latest_hum;
+static aht10_reading_t latest = { 0, 0 };
+static seqlock_t latest_lock = SEQLOCK_INIT;
+
+void aht10_get_latest_readings(int32_t *temp, int32_t *hum) {
+    aht10_reading_t reading;
+    seqlock_read(&latest_lock, &reading, &latest, sizeof(reading));
+    *temp = reading.temp;
+    *hum = reading.hum;
 }
 
 static void aht10_i2c_init(void) {
@@ -48,6 +58,9 @@ static void aht10_i2c_init(void) {
     // Habilita pull-ups internos (essencial se o módulo não tiver pull-ups fortes)
     gpio_pull_up(AHT10_I2C_SDA);
     gpio_pull_up(AHT10_I2C_SCL);
+
+    // Transferências por interrupção: a tarefa dorme enquanto o barramento trabalha
+    i2c_async_init(i2c0);
 }
 
 static void aht10_scan_bus(void) {
@@ -57,7 +70,7 @@ static void aht10_scan_bus(void) {
         if (addr < 0x08 || addr > 0x77) continue; // Endereços reservados
         
         uint8_t rxdata;
-        int ret = i2c_read_blocking(i2c0, addr, &rxdata, 1, false);
+        int ret = i2c_async_read(i2c0, addr, &rxdata, 1, AHT10_I2C_TIMEOUT_MS);
         
         if (ret >= 0) {
             printf("I2C0: Dispositivo encontrado em 0x%02X\n", addr);
@@ -76,20 +89,20 @@ static void aht10_scan_bus(void) {
 static bool aht10_check_connection(void) {
     uint8_t rxdata;
     // Tenta ler 1 byte apenas para ver se o sensor responde com ACK
-    int ret = i2c_read_blocking(i2c0, AHT10_ADDR, &rxdata, 1, false);
+    int ret = i2c_async_read(i2c0, AHT10_ADDR, &rxdata, 1, AHT10_I2C_TIMEOUT_MS);
     return ret >= 0;
 }
 
 static void aht10_soft_reset(void) {
     uint8_t cmd = AHT10_CMD_SOFT_RESET;
-    i2c_write_blocking(i2c0, AHT10_ADDR, &cmd, 1, false);
+    i2c_async_write(i2c0, AHT10_ADDR, &cmd, 1, AHT10_I2C_TIMEOUT_MS);
     vTaskDelay(pdMS_TO_TICKS(30)); // Datasheet pede 20ms, damos 30ms
 }
 
 static void aht10_calibrate(void) {
     // Comando de inicialização: 0xE1, 0x08, 0x00
     uint8_t cmd[3] = {AHT10_CMD_INIT, 0x08, 0x00};
-    i2c_write_blocking(i2c0, AHT10_ADDR, cmd, 3, false);
+    i2c_async_write(i2c0, AHT10_ADDR, cmd, 3, AHT10_I2C_TIMEOUT_MS);
     vTaskDelay(pdMS_TO_TICKS(20));
 }
 
@@ -123,7 +136,7 @@ void aht10_task(void *pvParameters) {
 
     while (1) {
         // 3. Envia comando de medição
-        int ret = i2c_write_blocking(i2c0, AHT10_ADDR, trigger_cmd, 3, false);
+        int ret = i2c_async_write(i2c0, AHT10_ADDR, trigger_cmd, 3, AHT10_I2C_TIMEOUT_MS);
         if (ret < 0) {
             printf("AHT10: Erro de comunicação (Trigger). Ret: %d\n", ret);
             // Tenta um soft reset para destravar
@@ -132,16 +145,25 @@ void aht10_task(void *pvParameters) {
             continue;
         }
 
-        // 4. Aguarda a medição (datasheet recomenda > 75ms)
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // 4. Aguarda a medição: consulta o bit de ocupado a partir do tempo
+        // típico de conversão e lê assim que ele cai, em vez de esperar o pior caso
+        TickType_t started = xTaskGetTickCount();
+        vTaskDelay(pdMS_TO_TICKS(AHT10_CONVERSION_MS));
+        uint8_t status = AHT10_STATUS_BUSY;
+        while (1) {
+            ret = i2c_async_read(i2c0, AHT10_ADDR, &status, 1, AHT10_I2C_TIMEOUT_MS);
+            if (ret < 0 || !(status & AHT10_STATUS_BUSY)) break;
+            if (xTaskGetTickCount() - started >= pdMS_TO_TICKS(AHT10_CONVERSION_TIMEOUT_MS)) break;
+            vTaskDelay(pdMS_TO_TICKS(AHT10_POLL_MS));
+        }
 
         // 5. Lê os 6 bytes de dados
-        ret = i2c_read_blocking(i2c0, AHT10_ADDR, data, 6, false);
+        if (ret >= 0) ret = i2c_async_read(i2c0, AHT10_ADDR, data, 6, AHT10_I2C_TIMEOUT_MS);
         if (ret < 0) {
             printf("AHT10: Erro de leitura dos dados.\n");
         } else {
             // Byte 0: Status
-            uint8_t status = data[0];
+            status = data[0];
 
             // Verifica se o sensor está ocupado (Bit 7)
             if ((status & AHT10_STATUS_BUSY) == 0) {
@@ -154,15 +176,14 @@ void aht10_task(void *pvParameters) {
                     uint32_t raw_hum = ((uint32_t)data[1] << 12) | ((uint32_t)data[2] << 4) | ((uint32_t)data[3] >> 4);
                     uint32_t raw_temp = (((uint32_t)data[3] & 0x0F) << 16) | ((uint32_t)data[4] << 8) | (uint32_t)data[5];
 
-                    // Fórmulas do datasheet
-                    float h = ((float)raw_hum * 100.0f) / 1048576.0f;
-                    float t = (((float)raw_temp * 200.0f) / 1048576.0f) - 50.0f;
+                    int32_t h = aht10_centi_humidity(raw_hum);
+                    int32_t t = aht10_centi_celsius(raw_temp);
 
-                    latest_hum = h;
-                    latest_temp = t;
+                    aht10_reading_t reading = { .temp = t, .hum = h };
+                    seqlock_write(&latest_lock, &latest, &reading, sizeof(reading));
                     
                     // Descomente para debug no serial
-                    // printf("AHT10: Temp=%.2f C, Hum=%.2f %%\n", t, h);
+                    // printf("AHT10: Temp=%ld cC, Hum=%ld c%%\n", (long)t, (long)h);
                 }
             } else {
                 printf("AHT10: Sensor ocupado (Busy)\n");
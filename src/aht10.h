@@ -3,6 +3,7 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include <stdint.h>
 
 // Definição dos pinos I2C0 (Adaptado: SDA=GP0, SCL=GP1)
 #define AHT10_I2C_SDA 0
@@ -18,14 +19,34 @@
 #define AHT10_STATUS_BUSY       0x80
 #define AHT10_STATUS_CALIBRATED 0x08
 
+// Tempos da medição
+#define AHT10_I2C_TIMEOUT_MS 10          // uma transferência (até 6 bytes a 100 kHz leva < 1 ms)
+#define AHT10_CONVERSION_MS 40           // primeira consulta do bit de ocupado
+#define AHT10_POLL_MS 5                  // consultas seguintes
+#define AHT10_CONVERSION_TIMEOUT_MS 150  // datasheet: até 75 ms
+
+// Fórmulas do datasheet em centésimos: raw * 10000 / 2^20 e
+// raw * 20000 / 2^20 - 5000, com os fatores reduzidos por 16 para caber
+// em 32 bits; arredonda somando meio antes do shift
+static inline int32_t aht10_centi_humidity(uint32_t raw_hum) {
+    return (int32_t)((raw_hum * 625u + (1u << 15)) >> 16);
+}
+
+static inline int32_t aht10_centi_celsius(uint32_t raw_temp) {
+    return (int32_t)((raw_temp * 1250u + (1u << 15)) >> 16) - 5000;
+}
+
 // Protótipo da tarefa
 void aht10_task(void *pvParameters);
 
 /**
  * @brief Obtém os últimos valores de temperatura e umidade lidos pela tarefa.
- * @param temp Ponteiro para armazenar a temperatura.
- * @param hum Ponteiro para armazenar a umidade.
+ *
+ * Em inteiros escalados (centésimos), formatados com fixed_format(): o M0+
+ * não tem FPU e cada operação em float seria uma chamada de biblioteca.
+ * @param temp Ponteiro para armazenar a temperatura, em centésimos de °C.
+ * @param hum Ponteiro para armazenar a umidade, em centésimos de %.
  */
-void aht10_get_latest_readings(float *temp, float *hum);
+void aht10_get_latest_readings(int32_t *temp, int32_t *hum);
 
 #endif // AHT10_H
\ No newline at end of file
@@ -6,38 +6,53 @@
  */
 
 #include "api_global.h"
-#include "lwip/tcp.h"
-#include "lwip/dns.h"
-#include "lwip/api.h"
-#include "pico/cyw43_arch.h"
+#include "http_client.h"
+#include "outbox.h"
 #include "aht10.h"
 #include "wifi_connection.h"
 #include "irrigator.h"
 #include "clock.h"
-#include "hardware/rtc.h"
+#include "fixed.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-#define RECV_BUFFER_SIZE 4096
-#define REQUEST_BUFFER_SIZE 2048
+#define PAYLOAD_BUFFER_SIZE 2048
 
 static char barear_token[512] = {0};
 static char api_host[64] = {0};
 static char api_base_path[64] = {0};
-static struct tcp_pcb *client_pcb;
-static ip_addr_t server_ip;
-static TaskHandle_t task_handle;
-
-// Buffer to store the response
-static char response_buffer[RECV_BUFFER_SIZE];
-static int response_pos = 0;
-
-// Request parameters
-static const char *current_method;
-static const char *current_path;
-static const char *current_body;
-static bool is_login_request = false;
+static bool api_use_tls = false;
+static char login_body[256] = {0};
+static char *exchange_body;
+static char *events_body;
+
+// Requests currently owned by the HTTP client
+static bool login_pending = false;
+static bool exchange_pending = false;
+static bool exchange_has_telemetry = false;
+static TickType_t login_retry_at = 0;
+static bool command_poll_pending = false;
+static TickType_t command_poll_retry_at = 0;
+static char command_poll_path[64] = {0};
+static bool events_pending = false;
+static TickType_t events_retry_at = 0;
+
+// Version of the schedule set last received from the server (0 = none yet)
+static uint32_t schedule_version = 0;
+
+// Values carried by the last telemetry upload, used to decide when to report again
+typedef struct {
+    bool valid;     // values below were accepted by the server
+    bool attempted; // sent_at holds the time of an upload attempt
+    int irrigator_on;
+    int32_t temp; // hundredths, as read from aht10.h
+    int32_t hum;
+    TickType_t sent_at;
+} telemetry_snapshot_t;
+
+static telemetry_snapshot_t last_report;
+static telemetry_snapshot_t pending_report;
 
 // Helper: Extract JSON value (Simplified version from api_local.c)
 static void get_json_value(const char *json, const char *key, char *value, size_t max_len) {
@@ -106,9 +121,12 @@ static bool get_json_bool_value(const char *json, const char *key, bool default_
     return default_val;
 }
 
-static void parse_schedules(const char *json) {
-    const char *schedules_key = "\"schedules\"";
-    const char *p = strstr(json, schedules_key);
+// Calls handle() with every object of the array under key (objects must not nest)
+static void parse_object_array(const char *json, const char *key, void (*handle)(const char *obj)) {
+    char search_key[64];
+    snprintf(search_key, sizeof(search_key), "\"%s\"", key);
+
+    const char *p = strstr(json, search_key);
     if (!p) return;
     
     p = strchr(p, '[');
@@ -131,29 +149,82 @@ static void parse_schedules(const char *json) {
         strncpy(obj_buf, obj_start, len);
         obj_buf[len] = '\0';
 
-        int index = get_json_int_value(obj_buf, "index", -1);
-
-        if (index >= 0 && index < IRRIGATOR_MAX_SCHEDULE_SIZE) {
-            int hour = get_json_int_value(obj_buf, "hour", 0);
-            int minute = get_json_int_value(obj_buf, "minute", 0);
-            int duration = get_json_int_value(obj_buf, "duration", 60);
-            bool active = get_json_bool_value(obj_buf, "active", false);
-
-            irrigator_set_schedule(index, (uint8_t)hour, (uint8_t)minute, (uint8_t)duration, (uint8_t)(active ? 1 : 0));
-            printf("API Global: Synced schedule %d: %02d:%02d dur=%d act=%d\n", index, hour, minute, duration, active);
-        }
+        handle(obj_buf);
 
         p = obj_end + 1;
     }
 }
 
-static void close_connection(struct tcp_pcb *pcb) {
-    if (pcb) {
-        tcp_arg(pcb, NULL);
-        tcp_sent(pcb, NULL);
-        tcp_recv(pcb, NULL);
-        tcp_err(pcb, NULL);
-        tcp_close(pcb);
+static void apply_schedule(const char *obj) {
+    int index = get_json_int_value(obj, "index", -1);
+    int zone = get_json_int_value(obj, "zone", 0);
+    schedule_item_t item = {
+        .hour = (uint8_t)get_json_int_value(obj, "hour", 0),
+        .minute = (uint8_t)get_json_int_value(obj, "minute", 0),
+        .duration = (uint16_t)irrigator_clamp_duration(get_json_int_value(obj, "duration", 60)),
+        .active = get_json_bool_value(obj, "active", false) ? 1 : 0,
+        .zone = (uint8_t)zone,
+        .days = (uint8_t)get_json_int_value(obj, "days", SCHEDULE_EVERY_DAY),
+        .season_start = (uint16_t)get_json_int_value(obj, "seasonStart", 0),
+        .season_end = (uint16_t)get_json_int_value(obj, "seasonEnd", 0),
+    };
+
+    if (zone < 0 || zone >= IRRIGATOR_ZONE_COUNT) {
+        printf("API Global: Schedule %d has invalid zone %d, ignored\n", index, zone);
+    } else if (irrigator_set_schedule(index, &item)) {
+        printf("API Global: Synced schedule %d: %02d:%02d dur=%d act=%d days=%02x\n",
+            index, item.hour, item.minute, item.duration, item.active, item.days);
+    }
+}
+
+// Local time as "YYYY-MM-DDTHH:MM:SS" (local time)
+static void format_timestamp(char *buffer, size_t size) {
+    datetime_t t;
+    if (!clock_get_time(&t)) memset(&t, 0, sizeof(t));
+    snprintf(buffer, size, "%04d-%02d-%02dT%02d:%02d:%02d", t.year, t.month, t.day, t.hour, t.min, t.sec);
+}
+
+static void push_event(outbox_class_t cls, const char *type, const char *fields) {
+    char ts[32]; // room for any datetime_t, not only valid dates
+    char record[OUTBOX_RECORD_SIZE];
+    format_timestamp(ts, sizeof(ts));
+    snprintf(record, sizeof(record), "{\"type\":\"%s\",\"time\":\"%s\"%s%s}", type, ts, fields[0] ? "," : "", fields);
+    outbox_push(cls, record);
+}
+
+// Same semantics as POST /irrigator on the local API
+static void apply_command(const char *obj) {
+    char action[16] = {0};
+    get_json_value(obj, "action", action, sizeof(action));
+
+    if (strcmp(action, "irrigate") == 0) {
+        int duration = irrigator_clamp_duration(get_json_int_value(obj, "duration", 60));
+        int zone = get_json_int_value(obj, "zone", 0);
+
+        printf("API Global: Remote command: irrigate zone %d for %d s\n", zone, duration);
+        if (!irrigator_zone_valid(zone)) {
+            push_event(OUTBOX_URGENT, "nack", "\"reason\":\"invalid zone\"");
+        } else if (irrigator_send_command(IRRIGATOR_TURN_ON, IRRIGATOR_SOURCE_GLOBAL_API, zone, duration)) {
+            char fields[64];
+            snprintf(fields, sizeof(fields), "\"action\":\"irrigate\",\"zone\":%d,\"duration\":%d", zone, duration);
+            push_event(OUTBOX_URGENT, "ack", fields);
+        } else {
+            push_event(OUTBOX_URGENT, "nack", "\"reason\":\"queue full\"");
+        }
+    } else if (strcmp(action, "stop") == 0) {
+        int zone = get_json_int_value(obj, "zone", -1);
+
+        printf("API Global: Remote command: stop\n");
+        if (!irrigator_zone_valid(zone)) {
+            push_event(OUTBOX_URGENT, "nack", "\"reason\":\"invalid zone\"");
+        } else if (irrigator_send_command(IRRIGATOR_TURN_OFF, IRRIGATOR_SOURCE_GLOBAL_API, zone, 0)) {
+            push_event(OUTBOX_URGENT, "ack", "\"action\":\"stop\"");
+        } else {
+            push_event(OUTBOX_URGENT, "nack", "\"reason\":\"queue full\"");
+        }
+    } else {
+        printf("API Global: Unknown remote command '%s'\n", action);
+        push_event(OUTBOX_URGENT, "nack", "\"reason\":\"unknown action\"");
     }
 }
 
@@ -161,6 +232,7 @@ static void parse_url_if_needed(void) {
     if (api_host[0] != '\0') return;
 
     const char *url = API_GLOBAL_URL;
+    api_use_tls = strncmp(url, "https://", 8) == 0;
     const char *p = strstr(url, "://");
     if (p) p += 3;
     else p = url;
@@ -181,242 +253,321 @@ static void parse_url_if_needed(void) {
     if (colon) *colon = '\0';
 }
 
-static err_t http_client_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
-    if (!p) {
-        // Connection closed by server
-        close_connection(pcb);
-        
-        // Process response
-        response_buffer[response_pos] = '\0';
-        
-        // Check for 401 Unauthorized
-        if (strstr(response_buffer, "HTTP/1.1 401") || strstr(response_buffer, "HTTP/1.0 401")) {
-            printf("API Global: 401 Unauthorized. Clearing token.\n");
-            memset(barear_token, 0, sizeof(barear_token));
-        } else if (is_login_request) {
-            // Try to extract token from body
-            char *body = strstr(response_buffer, "\r\n\r\n");
-            if (body) {
-                body += 4;
-                printf("API Global: Login Response Body: %s\n", body);
-
-                char new_token[512] = {0};
-                get_json_value(body, "token", new_token, sizeof(new_token));
-                if (strlen(new_token) > 0) {
-                    strncpy(barear_token, new_token, sizeof(barear_token) - 1);
-                    printf("API Global: Login successful. Token acquired.\n");
-                } else {
-                    printf("API Global: Login failed. No token in response.\n");
-                }
-            }
-        } else if (strstr(current_path, "/device/sync")) {
-             char *body = strstr(response_buffer, "\r\n\r\n");
-             if (body) {
-                 body += 4;
-                 parse_schedules(body);
-             }
-        } else {
-            // Telemetry response
-            if (strstr(response_buffer, "200 OK")) {
-                printf("API Global: Telemetry sent successfully.\n");
-            }
-        }
-
-        xTaskNotifyGive(task_handle);
-        return ERR_OK;
-    }
-
-    if (response_pos + p->tot_len < RECV_BUFFER_SIZE - 1) {
-        pbuf_copy_partial(p, response_buffer + response_pos, p->tot_len, 0);
-        response_pos += p->tot_len;
-    }
-    
-    tcp_recved(pcb, p->tot_len);
-    pbuf_free(p);
-    return ERR_OK;
+static bool is_success(const http_response_t *response) {
+    return response->status >= 200 && response->status < 300;
 }
 
-static err_t http_client_connected(void *arg, struct tcp_pcb *pcb, err_t err) {
-    if (err != ERR_OK) {
-        printf("API Global: Connection failed %d\n", err);
-        close_connection(pcb);
-        xTaskNotifyGive(task_handle);
-        return err;
-    }
-
-    char *request = malloc(REQUEST_BUFFER_SIZE);
-    if (!request) {
-        close_connection(pcb);
-        xTaskNotifyGive(task_handle);
-        return ERR_MEM;
+static void check_unauthorized(const http_response_t *response) {
+    if (response->status == 401) {
+        printf("API Global: 401 Unauthorized. Clearing token.\n");
+        memset(barear_token, 0, sizeof(barear_token));
     }
+}
 
-    int len;
-    if (is_login_request) {
-        len = snprintf(request, REQUEST_BUFFER_SIZE,
-            "%s %s%s HTTP/1.1\r\n"
-            "Host: %s:%d\r\n"
-            "Content-Type: application/json\r\n"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n"
-            "\r\n"
-            "%s",
-            current_method, api_base_path, current_path, api_host, API_PORT, (int)strlen(current_body), current_body);
-    } else {
-        len = snprintf(request, REQUEST_BUFFER_SIZE,
-            "%s %s%s HTTP/1.1\r\n"
-            "Host: %s:%d\r\n"
-            "Authorization: Bearer %s\r\n"
-            "Content-Type: application/json\r\n"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n"
-            "\r\n"
-            "%s",
-            current_method, api_base_path, current_path, api_host, API_PORT, barear_token, (int)strlen(current_body), current_body);
+static void on_login_done(const http_response_t *response, void *user) {
+    login_pending = false;
+
+    if (response->body) {
+        printf("API Global: Login Response Body: %s\n", response->body);
+
+        // One char more than barear_token holds: a token that fills it was cut short
+        char new_token[sizeof(barear_token) + 1] = {0};
+        get_json_value(response->body, "token", new_token, sizeof(new_token));
+        size_t token_len = strlen(new_token);
+        if (token_len >= sizeof(barear_token)) {
+            printf("API Global: Token longer than %u chars, rejected.\n", (unsigned)sizeof(barear_token) - 1);
+        } else if (token_len > 0) {
+            memcpy(barear_token, new_token, token_len + 1);
+            printf("API Global: Login successful. Token acquired.\n");
+            return;
+        }
     }
 
-    tcp_write(pcb, request, len, TCP_WRITE_FLAG_COPY);
-    tcp_output(pcb);
-    free(request);
+    printf("API Global: Login failed (status %d). Retrying later.\n", response->status);
+    login_retry_at = xTaskGetTickCount() + pdMS_TO_TICKS(API_LOGIN_RETRY_MS);
+}
 
-    return ERR_OK;
+// Schedule deltas and commands, as returned by both the sync exchange and the command poll
+static void apply_server_updates(const char *body) {
+    // Only changed slots are sent, so they are applied as they come
+    parse_object_array(body, "schedules", apply_schedule);
+    parse_object_array(body, "commands", apply_command);
+    schedule_version = (uint32_t)get_json_int_value(body, "scheduleVersion", (int)schedule_version);
 }
 
-static void http_client_err(void *arg, err_t err) {
-    printf("API Global: TCP Error %d\n", err);
-    xTaskNotifyGive(task_handle);
+// Compact telemetry record kept as history while the server cannot be reached
+static void push_history(const telemetry_snapshot_t *snapshot) {
+    char fields[80], temp[FIXED_STR_SIZE], hum[FIXED_STR_SIZE];
+    fixed_format(temp, snapshot->temp, 2);
+    fixed_format(hum, snapshot->hum, 2);
+    snprintf(fields, sizeof(fields), "\"temperature\":%s,\"humidity\":%s,\"active\":%s",
+        temp, hum, snapshot->irrigator_on ? "true" : "false");
+    push_event(OUTBOX_BULK, "telemetry", fields);
 }
 
-static void dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_arg) {
-    if (ipaddr) {
-        server_ip = *ipaddr;
-        
-        client_pcb = tcp_new();
-        if (client_pcb) {
-            tcp_arg(client_pcb, NULL);
-            tcp_recv(client_pcb, http_client_recv);
-            tcp_err(client_pcb, http_client_err);
-            tcp_connect(client_pcb, &server_ip, API_PORT, http_client_connected);
-        } else {
-            xTaskNotifyGive(task_handle);
+static void on_exchange_done(const http_response_t *response, void *user) {
+    exchange_pending = false;
+    check_unauthorized(response);
+
+    if (is_success(response)) {
+        if (response->body) {
+            apply_server_updates(response->body);
+        }
+        if (exchange_has_telemetry) {
+            last_report = pending_report;
+            printf("API Global: Telemetry sent successfully (%lu ms).\n", (unsigned long)response->elapsed_ms);
+        }
+    } else if (exchange_has_telemetry) {
+        // Keep the old values so the change is retried after the minimum interval
+        last_report.attempted = true;
+        last_report.sent_at = pending_report.sent_at;
+        if (response->status == 0) {
+            push_history(&pending_report);
         }
-    } else {
-        printf("API Global: DNS Failed\n");
-        xTaskNotifyGive(task_handle);
     }
 }
 
-static void perform_request(const char *method, const char *path, const char *body, bool is_login) {
-    current_method = method;
-    current_path = path;
-    current_body = body;
-    is_login_request = is_login;
-    response_pos = 0;
+static void on_events_done(const http_response_t *response, void *user) {
+    events_pending = false;
+    check_unauthorized(response);
 
-    parse_url_if_needed();
+    bool delivered = is_success(response);
+    outbox_complete_batch(delivered);
+    if (!delivered) {
+        events_retry_at = xTaskGetTickCount() + pdMS_TO_TICKS(API_EVENTS_RETRY_MS);
+    }
+}
 
-    cyw43_arch_lwip_begin();
-    
-    int err = dns_gethostbyname(api_host, &server_ip, dns_found, NULL);
-    
-    if (err == ERR_OK) {
-        // IP already cached
-        dns_found(api_host, &server_ip, NULL);
-    } else if (err != ERR_INPROGRESS) {
-        printf("API Global: DNS Error %d\n", err);
-        xTaskNotifyGive(task_handle); // Unlock task immediately on error
+// Queues irrigator transitions and temperature alarms (edge-triggered)
+static void detect_events(const telemetry_snapshot_t *current) {
+    static int last_irrigator_on = -1;
+    static bool temp_alarm = false;
+
+    if (last_irrigator_on >= 0 && current->irrigator_on != last_irrigator_on) {
+        push_event(OUTBOX_STATE, "irrigator", current->irrigator_on ? "\"active\":true" : "\"active\":false");
     }
-    
-    cyw43_arch_lwip_end();
+    last_irrigator_on = current->irrigator_on;
+
+    bool over = current->temp >= API_ALARM_TEMP_MAX;
+    if (over && !temp_alarm) {
+        char fields[48], value[FIXED_STR_SIZE];
+        fixed_format(value, current->temp, 2);
+        snprintf(fields, sizeof(fields), "\"alarm\":\"temperature\",\"value\":%s", value);
+        push_event(OUTBOX_URGENT, "alarm", fields);
+    }
+    temp_alarm = over;
+}
+
+static void on_command_poll_done(const http_response_t *response, void *user) {
+    command_poll_pending = false;
+    check_unauthorized(response);
 
-    // Wait for request to complete (timeout 10s)
-    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10000));
+    if (is_success(response)) {
+        // 200 with updates, or 204 when the server's hold time ran out; re-armed right away
+        if (response->body && response->body_len > 0) {
+            apply_server_updates(response->body);
+        }
+    } else {
+        command_poll_retry_at = xTaskGetTickCount() + pdMS_TO_TICKS(API_COMMAND_POLL_RETRY_MS);
+    }
 }
 
-static void generate_telemetry_json(char *buffer, size_t size) {
+static int generate_telemetry_json(char *buffer, size_t size) {
     datetime_t t;
     if (!clock_get_time(&t)) memset(&t, 0, sizeof(t));
     
-    float temp, hum;
-    aht10_get_latest_readings(&temp, &hum);
+    int32_t temp_c, hum_c;
+    aht10_get_latest_readings(&temp_c, &hum_c);
+    char temp[FIXED_STR_SIZE], hum[FIXED_STR_SIZE];
+    fixed_format(temp, temp_c, 2);
+    fixed_format(hum, hum_c, 2);
     
-    schedule_item_t schedules[IRRIGATOR_MAX_SCHEDULE_SIZE];
-    irrigator_get_all_schedules(schedules);
-
     int offset = 0;
     offset += snprintf(buffer + offset, size - offset, 
         "{"
         "\"clock\":{\"synchronizedNTP\":%s,\"time\":{\"year\":%d,\"month\":%d,\"day\":%d,\"dotw\":%d,\"hour\":%d,\"min\":%d,\"sec\":%d}},"
-        "\"irrigator\":{\"active\":%s,\"schedule\":[",
+        "\"irrigator\":{\"active\":%s,\"schedule\":",
         is_ntp_synchronized() ? "true" : "false",
         t.year, t.month, t.day, t.dotw, t.hour, t.min, t.sec,
         irrigator_is_on() ? "true" : "false"
     );
 
-    for (int i = 0; i < IRRIGATOR_MAX_SCHEDULE_SIZE; i++) {
-        if (i > 0) offset += snprintf(buffer + offset, size - offset, ",");
-        offset += snprintf(buffer + offset, size - offset, 
-            "{\"index\":%d,\"hour\":%d,\"minute\":%d,\"duration\":%d,\"active\":%d}",
-            i, schedules[i].hour, schedules[i].minute, schedules[i].duration, schedules[i].active);
-    }
+    // Leaves room for the fields after the array; truncated to whole entries
+    int room = (int)size - offset - 160;
+    offset += irrigator_schedules_to_json(buffer + offset, room > 3 ? (size_t)room : 3);
 
     offset += snprintf(buffer + offset, size - offset, 
-        "]},"
-        "\"sensors\":{\"temperature\":%.2f,\"humidity\":%.2f},"
+        "},"
+        "\"sensors\":{\"temperature\":%s,\"humidity\":%s},"
         "\"wifi\":{\"hasInternetConnection\":%s}"
         "}",
         temp, hum,
         wifi_has_internet() ? "true" : "false"
     );
+
+    return offset;
+}
+
+// Body of POST /device/sync: the schedule version the device holds plus
+// zero or one telemetry records, so one round trip does both jobs
+static void generate_exchange_json(char *buffer, size_t size, bool with_telemetry) {
+    int offset = snprintf(buffer, size, "{\"scheduleVersion\":%lu,\"telemetry\":[", (unsigned long)schedule_version);
+    if (with_telemetry && offset < (int)size) {
+        offset += generate_telemetry_json(buffer + offset, size - offset);
+    }
+    if (offset < (int)size) {
+        snprintf(buffer + offset, size - offset, "]}");
+    }
+}
+
+// Decides whether the current state differs enough from the last report to upload it now
+static bool telemetry_is_due(const telemetry_snapshot_t *current, TickType_t now) {
+    TickType_t elapsed = now - last_report.sent_at;
+    if (last_report.attempted && elapsed < pdMS_TO_TICKS(API_TELEMETRY_MIN_INTERVAL_MS)) return false;
+
+    if (!last_report.valid) return true;
+    if (elapsed >= pdMS_TO_TICKS(API_TELEMETRY_HEARTBEAT_MS)) return true;
+
+    if (current->irrigator_on != last_report.irrigator_on) return true;
+    if (abs((int)(current->temp - last_report.temp)) >= API_TELEMETRY_TEMP_DELTA) return true;
+    if (abs((int)(current->hum - last_report.hum)) >= API_TELEMETRY_HUM_DELTA) return true;
+
+    return false;
+}
+
+// A cycle starts with the first request submitted while the client is idle
+// and ends when every request it led to has completed.
+static void log_cycle_stats(bool *cycle_active, TickType_t *cycle_started_at) {
+    if (!API_GLOBAL_LOG_CYCLE_STATS) return;
+
+    if (!*cycle_active) {
+        if (http_client_pending() - (command_poll_pending ? 1 : 0) == 0) return;
+        *cycle_active = true;
+        *cycle_started_at = xTaskGetTickCount();
+        return;
+    }
+
+    // The command poll is always open, so it does not count towards a cycle
+    if (http_client_pending() - (command_poll_pending ? 1 : 0) > 0) return;
+
+    http_client_stats_t stats;
+    http_client_get_stats(&stats);
+    printf("API Global: Cycle %lu ms, %lu requests (%lu failed), tx %lu B, rx %lu B, %lu allocs\n",
+        (unsigned long)pdTICKS_TO_MS(xTaskGetTickCount() - *cycle_started_at),
+        (unsigned long)stats.requests, (unsigned long)stats.failures,
+        (unsigned long)stats.bytes_sent, (unsigned long)stats.bytes_received,
+        (unsigned long)stats.allocations);
+    if (stats.tls_full_handshakes || stats.tls_resumed_handshakes) {
+        printf("API Global: TLS handshakes: %lu full (%lu ms), %lu resumed (%lu ms)\n",
+            (unsigned long)stats.tls_full_handshakes, (unsigned long)stats.tls_full_handshake_ms,
+            (unsigned long)stats.tls_resumed_handshakes, (unsigned long)stats.tls_resumed_handshake_ms);
+    }
+    http_client_reset_stats();
+    *cycle_active = false;
 }
 
 void api_global_task(void *pvParameters) {
-    task_handle = xTaskGetCurrentTaskHandle();
-    char *payload_buffer = malloc(2048);
+    exchange_body = malloc(PAYLOAD_BUFFER_SIZE);
+    events_body = malloc(OUTBOX_BATCH_MAX_SIZE);
 
-    if (!payload_buffer) {
+    if (!exchange_body || !events_body) {
         printf("API Global: Failed to allocate payload buffer\n");
         vTaskDelete(NULL);
     }
 
+    parse_url_if_needed();
+    uint16_t port = API_PORT ? API_PORT : (api_use_tls ? 443 : 80);
+    http_client_init(api_host, port, api_base_path, api_use_tls, API_TLS_CA_CERT, API_TLS_ALLOW_UNVERIFIED);
+
+    snprintf(login_body, sizeof(login_body),
+        "{\"serial_number\": \"%s\", \"secret_token\": \"%s\"}",
+        API_CONNECTION_SERIAL_NUMBER, API_CONNECTION_SECRET_TOKEN);
+
+    bool synced_once = false;
+    TickType_t last_sync = 0;
+    bool cycle_active = false;
+    TickType_t cycle_started_at = 0;
+
     while (1) {
+        TickType_t now = xTaskGetTickCount();
+        telemetry_snapshot_t current = { .valid = true, .attempted = true, .irrigator_on = irrigator_is_on(), .sent_at = now };
+        aht10_get_latest_readings(&current.temp, &current.hum);
+        detect_events(&current);
+
+        bool online = wifi_has_internet() && strlen(barear_token) > 0;
+        if (!online && telemetry_is_due(&current, now)) {
+            // Keep history while the server cannot be reached; drained later as bulk
+            push_history(&current);
+            last_report = current;
+        }
+
         if (wifi_has_internet()) {
-            
-            // 1. Login if needed
+
             if (strlen(barear_token) == 0) {
-                printf("API Global: Authenticating...\n");
-                snprintf(payload_buffer, 2048, 
-                    "{\"serial_number\": \"%s\", \"secret_token\": \"%s\"}", 
-                    API_CONNECTION_SERIAL_NUMBER, API_CONNECTION_SECRET_TOKEN);
-                
-                perform_request("POST", "/device/login", payload_buffer, true);
-                
-                if (strlen(barear_token) == 0) {
-                    // Login failed, wait before retry
-                    vTaskDelay(pdMS_TO_TICKS(10000));
-                    continue;
+                // 1. Login if needed; the sync exchange waits for the token
+                if (!login_pending && (int32_t)(now - login_retry_at) >= 0) {
+                    printf("API Global: Authenticating...\n");
+                    http_request_params_t login = {
+                        .method = "POST", .path = "/device/login", .body = login_body,
+                        .max_retries = 2, .on_done = on_login_done,
+                    };
+                    login_pending = http_client_submit(&login) >= 0;
+                }
+            } else {
+                // 2. Queued events, on their own request so a slow sync never delays them
+                if (!events_pending && outbox_waiting() > 0 && (int32_t)(now - events_retry_at) >= 0) {
+                    int count = outbox_build_batch(events_body, OUTBOX_BATCH_MAX_SIZE);
+                    if (count > 0) {
+                        http_request_params_t events = {
+                            .method = "POST", .path = "/device/events", .body = events_body,
+                            .bearer_token = barear_token, .max_retries = 1, .compress_body = true,
+                            .on_done = on_events_done,
+                        };
+                        events_pending = http_client_submit(&events) >= 0;
+                        if (!events_pending) outbox_complete_batch(false);
+                    }
                 }
-            }
 
-            // 2. Sync Schedules
-            if (strlen(barear_token) > 0) {
-                printf("API Global: Syncing schedules...\n");
-                perform_request("GET", "/device/sync", "", false);
-            }
+                // 3. Sync schedules and send telemetry in a single exchange
+                bool sync_due = !synced_once || now - last_sync >= pdMS_TO_TICKS(API_SYNC_INTERVAL_MS);
+                bool telemetry_due = telemetry_is_due(&current, now);
+
+                if (!exchange_pending && (sync_due || telemetry_due)) {
+                    printf("API Global: Syncing%s...\n", telemetry_due ? " with telemetry" : "");
+                    generate_exchange_json(exchange_body, PAYLOAD_BUFFER_SIZE, telemetry_due);
+                    http_request_params_t exchange = {
+                        .method = "POST", .path = "/device/sync", .body = exchange_body,
+                        .bearer_token = barear_token, .max_retries = 2, .compress_body = true,
+                        .on_done = on_exchange_done,
+                    };
+                    if (http_client_submit(&exchange) >= 0) {
+                        exchange_pending = true;
+                        exchange_has_telemetry = telemetry_due;
+                        pending_report = current;
+                        synced_once = true;
+                        last_sync = now;
+                    }
+                }
 
-            // 3. Send Telemetry
-            printf("API Global: Sending telemetry...\n");
-            generate_telemetry_json(payload_buffer, 2048);
-            perform_request("POST", "/telemetry", payload_buffer, false);
+                // 4. Keep a long poll open so commands arrive within one round trip
+                if (API_COMMAND_POLL_ENABLED && synced_once && !command_poll_pending &&
+                    (int32_t)(now - command_poll_retry_at) >= 0) {
+                    snprintf(command_poll_path, sizeof(command_poll_path), "/device/commands?wait=%d&scheduleVersion=%lu",
+                        API_COMMAND_POLL_WAIT_S, (unsigned long)schedule_version);
+                    http_request_params_t poll = {
+                        .method = "GET", .path = command_poll_path, .bearer_token = barear_token,
+                        .timeout_ms = API_COMMAND_POLL_WAIT_S * 1000 + API_COMMAND_POLL_MARGIN_MS,
+                        .on_done = on_command_poll_done,
+                    };
+                    command_poll_pending = http_client_submit(&poll) >= 0;
+                }
+            }
+        }
 
-            // Wait 60 seconds before next telemetry
-            vTaskDelay(pdMS_TO_TICKS(60000));
+        log_cycle_stats(&cycle_active, &cycle_started_at);
 
-        } else {
-            // Wait for internet
-            vTaskDelay(pdMS_TO_TICKS(2000));
-        }
+        // Dispatches completions and sleeps until the next check, timeout or retry
+        http_client_poll(pdMS_TO_TICKS(API_TELEMETRY_CHECK_MS));
+        log_cycle_stats(&cycle_active, &cycle_started_at);
     }
-    
-    free(payload_buffer);
 }
@@ -13,16 +13,71 @@
  #include "FreeRTOS.h"
  #include "task.h"
 
- // https://sua-api.exemplo.com
+ // https://sua-api.exemplo.com (https:// enables TLS)
+ // Both can be overridden at build time, e.g. to point the device at a local test server
+ #ifndef API_GLOBAL_URL
  #define API_GLOBAL_URL "URL_DA_SUA_API"
- #define API_PORT 80
+ #endif
+ #ifndef API_PORT
+ #define API_PORT 0 // 0 = scheme default (80 for http, 443 for https)
+ #endif
+
+ // PEM certificate of the CA that signed the server certificate. The server
+ // must present a certificate it signed, for the host in API_GLOBAL_URL.
+ #ifndef API_TLS_CA_CERT
+ #define API_TLS_CA_CERT NULL
+ #endif
+
+ // Without a CA certificate, https:// requests fail unless this is true.
+ // true connects without verifying the server: traffic is encrypted, but
+ // anyone on the path can impersonate it and read the token. Testing only.
+ #define API_TLS_ALLOW_UNVERIFIED false
 
  // login
  #define API_CONNECTION_SERIAL_NUMBER "NUMERO_SERIAL_OU_LOGIN"
  #define API_CONNECTION_SECRET_TOKEN "TOKEN_OU_SENHA"
 
+ // sync / telemetry policy
+ #define API_LOGIN_RETRY_MS 10000                    // wait after a failed login
+ #ifndef API_SYNC_INTERVAL_MS
+ #define API_SYNC_INTERVAL_MS 60000                  // schedule sync cadence
+ #endif
+ #define API_TELEMETRY_CHECK_MS 1000                 // how often the task looks for changes
+ #define API_TELEMETRY_MIN_INTERVAL_MS 5000          // never report faster than this
+ #define API_TELEMETRY_HEARTBEAT_MS (15 * 60 * 1000) // report at least this often
+ #define API_TELEMETRY_TEMP_DELTA 50                 // change that forces a report, hundredths of °C
+ #define API_TELEMETRY_HUM_DELTA 200                 // change that forces a report, hundredths of %
+
+ // Outbound events (see outbox.h): acks, alarms, state changes and offline history
+ #define API_EVENTS_RETRY_MS 5000     // wait after a failed POST /device/events
+ #define API_ALARM_TEMP_MAX 4500      // hundredths of °C, raises an urgent alarm when crossed upwards
+
+ // Long-poll command channel: the server holds GET /device/commands open for up to
+ // API_COMMAND_POLL_WAIT_S and answers as soon as a command or schedule change exists
+ #define API_COMMAND_POLL_ENABLED true
+ #define API_COMMAND_POLL_WAIT_S 25
+ #define API_COMMAND_POLL_MARGIN_MS 10000 // client timeout beyond the hold time
+ #define API_COMMAND_POLL_RETRY_MS 5000   // wait after a failed poll
+
+ // Prints time, bytes and allocations of every exchange with the server
+ #define API_GLOBAL_LOG_CYCLE_STATS true
+
 /**
  * @brief Task that initializes the global API connection once Wi-Fi is connected.
+ *
+ * Every exchange is a single POST /device/sync carrying the schedule version
+ * held by the device and, when due, a telemetry record. The response carries
+ * the schedule slots that changed since that version plus pending commands.
+ *
+ * An exchange happens every API_SYNC_INTERVAL_MS, and also as soon as the
+ * irrigator toggles or a sensor reading moves past its delta threshold.
+ * Telemetry is otherwise only included as a heartbeat every API_TELEMETRY_HEARTBEAT_MS.
+ *
+ * Queued events go out through POST /device/events by priority (see outbox.h),
+ * on their own connection, so an urgent ack is never stuck behind a sync.
+ *
+ * A long poll on GET /device/commands stays open on its own connection and
+ * delivers commands and schedule changes as soon as the server has them.
  * @param pvParameters Task parameters (unused).
  */
 void api_global_task(void *pvParameters);
@@ -11,12 +11,16 @@
 #include "aht10.h"
 #include "wifi_connection.h"
 #include "irrigator.h"
-#include "hardware/rtc.h"
+#include "journal.h"
+#include "clock.h"
+#include "fixed.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #define RX_BUFFER_SIZE 4096
+#define EVENTS_MAX_PAGE_SIZE 25 // keeps a page of GET /irrigator/events within RX_BUFFER_SIZE
+#define TOTALS_DAYS 14          // days reported by GET /irrigator/totals
 
 static struct tcp_pcb *server_pcb;
 
@@ -84,9 +88,118 @@ static bool get_json_bool_value(const char *json, const char *key, bool default_
     return default_val;
 }
 
+// Integer query parameter from the request line ("GET /path?key=value&... HTTP/1.1")
+static int get_query_int_value(const char *request, const char *key, int default_val) {
+    const char *line_end = strstr(request, "\r\n");
+    const char *query = strchr(request, '?');
+    if (!query || (line_end && query > line_end)) return default_val;
+
+    size_t key_len = strlen(key);
+    for (const char *p = query + 1; *p && *p != ' ' && (!line_end || p < line_end); p++) {
+        if ((p[-1] == '?' || p[-1] == '&') && strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            return atoi(p + key_len + 1);
+        }
+    }
+    return default_val;
+}
+
+static const char *source_name(uint8_t source) {
+    switch (source) {
+        case IRRIGATOR_SOURCE_BUTTON: return "button";
+        case IRRIGATOR_SOURCE_LOCAL_API: return "local";
+        case IRRIGATOR_SOURCE_GLOBAL_API: return "cloud";
+        case IRRIGATOR_SOURCE_SCHEDULE: return "schedule";
+        default: return "unknown";
+    }
+}
+
+// One page of the journal, newest first; only the requested records are formatted
+static int build_events_json(char *buffer, size_t size, int page, int page_size) {
+    uint32_t first, next;
+    journal_range(&first, &next);
+
+    int offset = snprintf(buffer, size, "{\"first\":%lu,\"next\":%lu,\"page\":%d,\"size\":%d,\"events\":[",
+        (unsigned long)first, (unsigned long)next, page, page_size);
+
+    uint32_t skip = (uint32_t)page * (uint32_t)page_size;
+    int written = 0;
+    for (uint32_t k = skip; k < next - first && written < page_size; k++) {
+        uint32_t seq = next - 1 - k;
+        journal_event_t event;
+        if (!journal_read(seq, &event)) break; // overwritten meanwhile
+
+        char time[24];
+        journal_format_time(event.time, time, sizeof(time));
+        offset += snprintf(buffer + offset, size - offset,
+            "%s{\"seq\":%lu,\"time\":\"%s\",\"type\":\"%s\",\"zone\":%d,\"source\":\"%s\",\"planned\":%d,\"actual\":%d,\"litres\":%d.%d}",
+            written ? "," : "", (unsigned long)seq, time, event.type == JOURNAL_START ? "start" : event.type == JOURNAL_STOP ? "stop" : "skip",
+            event.zone, source_name(event.source), event.planned_s, event.actual_s, event.volume_dl / 10, event.volume_dl % 10);
+        written++;
+    }
+
+    offset += snprintf(buffer + offset, size - offset, "]}");
+    return offset;
+}
+
+// Irrigation seconds and litres per zone for the most recent days in the journal (by stop date)
+static int build_totals_json(char *buffer, size_t size) {
+    uint32_t day_index[TOTALS_DAYS];
+    uint32_t seconds[TOTALS_DAYS][IRRIGATOR_ZONE_COUNT] = {0};
+    uint32_t volume_dl[TOTALS_DAYS][IRRIGATOR_ZONE_COUNT] = {0};
+    int days = 0;
+
+    uint32_t first, next;
+    journal_range(&first, &next);
+    for (uint32_t seq = next; seq-- > first;) {
+        journal_event_t event;
+        if (!journal_read(seq, &event)) break;
+        if (event.type != JOURNAL_STOP || event.zone >= IRRIGATOR_ZONE_COUNT) continue;
+
+        uint32_t day = event.time / 86400u;
+        int d = 0;
+        while (d < days && day_index[d] != day) d++;
+        if (d == days) {
+            if (days == TOTALS_DAYS) continue;
+            day_index[days++] = day;
+        }
+        seconds[d][event.zone] += event.actual_s;
+        volume_dl[d][event.zone] += event.volume_dl;
+    }
+
+    int offset = snprintf(buffer, size, "{\"days\":[");
+    for (int d = 0; d < days; d++) {
+        char date[24];
+        journal_format_time(day_index[d] * 86400u, date, sizeof(date));
+        date[10] = '\0'; // YYYY-MM-DD
+
+        offset += snprintf(buffer + offset, size - offset, "%s{\"date\":\"%s\",\"seconds\":[", d ? "," : "", date);
+        for (int z = 0; z < IRRIGATOR_ZONE_COUNT; z++) {
+            offset += snprintf(buffer + offset, size - offset, "%s%lu", z ? "," : "", (unsigned long)seconds[d][z]);
+        }
+        offset += snprintf(buffer + offset, size - offset, "],\"litres\":[");
+        for (int z = 0; z < IRRIGATOR_ZONE_COUNT; z++) {
+            offset += snprintf(buffer + offset, size - offset, "%s%lu.%lu", z ? "," : "",
+                (unsigned long)(volume_dl[d][z] / 10), (unsigned long)(volume_dl[d][z] % 10));
+        }
+        offset += snprintf(buffer + offset, size - offset, "]}");
+    }
+    offset += snprintf(buffer + offset, size - offset, "]}");
+    return offset;
+}
+
+static const char *http_status_text(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "Bad Request";
+    }
+}
+
 static err_t http_send_response(struct tcp_pcb *pcb, const char *payload, int code) {
     char header[128];
-    const char *status_str = (code == 200) ? "OK" : "Bad Request";
+    const char *status_str = http_status_text(code);
     
     snprintf(header, sizeof(header), 
         "HTTP/1.1 %d %s\r\n"
@@ -200,27 +313,24 @@ static err_t http_recv_callback(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
             t.min   = (int8_t)get_json_int_value(body, "min", 0);
             t.sec   = (int8_t)get_json_int_value(body, "sec", 0);
 
-            if (rtc_set_datetime(&t)) {
+            if (clock_set_time(&t)) {
+                BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+                irrigator_reschedule_from_isr(&xHigherPriorityTaskWoken);
                 http_send_response(pcb, "{\"status\": \"clock updated\"}", 200);
+                portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
             } else {
                 http_send_response(pcb, "{\"status\": \"invalid datetime\"}", 400);
             }
         }
     } else if (strncmp(rx_buffer, "GET /schedule ", 14) == 0) {
-        schedule_item_t schedules[4];
-        irrigator_get_all_schedules(schedules);
-        
-        char response[512];
-        int offset = snprintf(response, sizeof(response), "[");
-        for (int i = 0; i < 4; i++) {
-            if (i > 0) offset += snprintf(response + offset, sizeof(response) - offset, ",");
-            offset += snprintf(response + offset, sizeof(response) - offset, 
-                "{\"index\":%d,\"hour\":%d,\"minute\":%d,\"duration\":%d,\"active\":%d}",
-                i, schedules[i].hour, schedules[i].minute, schedules[i].duration, schedules[i].active);
+        char *response = malloc(RX_BUFFER_SIZE);
+        if (response) {
+            irrigator_schedules_to_json(response, RX_BUFFER_SIZE);
+            http_send_response(pcb, response, 200);
+            free(response);
+        } else {
+            http_send_response(pcb, "{\"error\": \"memory\"}", 500);
         }
-        snprintf(response + offset, sizeof(response) - offset, "]");
-        
-        http_send_response(pcb, response, 200);
     } else if (strncmp(rx_buffer, "GET /status ", 12) == 0) {
         char *response = malloc(RX_BUFFER_SIZE);
         if (response) {
@@ -229,33 +339,39 @@ static err_t http_recv_callback(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
             datetime_t t;
             if (!clock_get_time(&t)) memset(&t, 0, sizeof(t));
             
-            float temp, hum;
-            aht10_get_latest_readings(&temp, &hum);
+            clock_sync_info_t sync;
+            clock_get_sync_info(&sync);
+
+            int32_t temp_c, hum_c;
+            aht10_get_latest_readings(&temp_c, &hum_c);
+            char temp[FIXED_STR_SIZE], hum[FIXED_STR_SIZE];
+            fixed_format(temp, temp_c, 2);
+            fixed_format(hum, hum_c, 2);
             
-            schedule_item_t schedules[IRRIGATOR_MAX_SCHEDULE_SIZE];
-            irrigator_get_all_schedules(schedules);
-
             offset += snprintf(response + offset, RX_BUFFER_SIZE - offset, 
                 "{"
-                "\"clock\":{\"synchronizedNTP\":%s,\"time\":{\"year\":%d,\"month\":%d,\"day\":%d,\"dotw\":%d,\"hour\":%d,\"min\":%d,\"sec\":%d}},"
-                "\"irrigator\":{\"active\":%s,\"schedule\":[",
+                "\"clock\":{\"synchronizedNTP\":%s,\"time\":{\"year\":%d,\"month\":%d,\"day\":%d,\"dotw\":%d,\"hour\":%d,\"min\":%d,\"sec\":%d},"
+                "\"frequencyPpb\":%ld,\"pollS\":%lu,\"lastOffsetUs\":%ld},"
+                "\"irrigator\":{\"active\":%s,\"schedule\":",
                 is_ntp_synchronized() ? "true" : "false",
                 t.year, t.month, t.day, t.dotw, t.hour, t.min, t.sec,
+                (long)sync.freq_ppb, (unsigned long)sync.poll_s, (long)sync.last_offset_us,
                 irrigator_is_on() ? "true" : "false"
             );
 
-            for (int i = 0; i < IRRIGATOR_MAX_SCHEDULE_SIZE; i++) {
-                if (i > 0) offset += snprintf(response + offset, RX_BUFFER_SIZE - offset, ",");
-                offset += snprintf(response + offset, RX_BUFFER_SIZE - offset, 
-                    "{\"index\":%d,\"hour\":%d,\"minute\":%d,\"duration\":%d,\"active\":%d}",
-                    i, schedules[i].hour, schedules[i].minute, schedules[i].duration, schedules[i].active);
-            }
+            // Leaves room for the fields that follow the array
+            offset += irrigator_schedules_to_json(response + offset, RX_BUFFER_SIZE - offset - 512);
+
+            irrigator_command_stats_t commands;
+            irrigator_get_command_stats(&commands);
 
             offset += snprintf(response + offset, RX_BUFFER_SIZE - offset, 
-                "]},"
-                "\"sensors\":{\"temperature\":%.2f,\"humidity\":%.2f},"
+                ",\"commands\":{\"received\":%lu,\"dropped\":%lu,\"lastLatencyUs\":%lu,\"maxLatencyUs\":%lu}},"
+                "\"sensors\":{\"temperature\":%s,\"humidity\":%s},"
                 "\"wifi\":{\"hasInternetConnection\":%s}"
                 "}",
+                (unsigned long)commands.received, (unsigned long)commands.dropped,
+                (unsigned long)commands.last_latency_us, (unsigned long)commands.max_latency_us,
                 temp, hum,
                 wifi_has_internet() ? "true" : "false"
             );
@@ -273,12 +389,12 @@ static err_t http_recv_callback(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
             datetime_t t;
             if (!clock_get_time(&t)) memset(&t, 0, sizeof(t));
             
-            float temp, hum;
-            aht10_get_latest_readings(&temp, &hum);
+            int32_t temp_c, hum_c;
+            aht10_get_latest_readings(&temp_c, &hum_c);
+            char temp[FIXED_STR_SIZE], hum[FIXED_STR_SIZE];
+            fixed_format(temp, temp_c, 2);
+            fixed_format(hum, hum_c, 2);
             
-            schedule_item_t schedules[IRRIGATOR_MAX_SCHEDULE_SIZE];
-            irrigator_get_all_schedules(schedules);
-
             struct netif *n = &cyw43_state.netif[CYW43_ITF_STA];
             char ip_str[16];
             strncpy(ip_str, ip4addr_ntoa(netif_ip4_addr(n)), sizeof(ip_str));
@@ -290,24 +406,20 @@ static err_t http_recv_callback(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
                 "\"buttons\":{\"name\":\"Botões A/B\",\"description\":\"(A) Ligar, (B) Desligar (Prioritário).\"},"
                 "\"buzzer\":{\"name\":\"Buzzer\",\"description\":\"Feedback sonoro.\"},"
                 "\"clock\":{\"name\":\"RTC\",\"description\":\"Relógio interno (sincroniza via NTP).\",\"synchronizedNTP\":%s,\"time\":{\"year\":%d,\"month\":%d,\"day\":%d,\"dotw\":%d,\"hour\":%d,\"min\":%d,\"sec\":%d}},"
-                "\"irrigator\":{\"name\":\"Irrigador\",\"description\":\"Relé 5V para válvula solenoide.\",\"active\":%s,\"schedule\":[",
+                "\"irrigator\":{\"name\":\"Irrigador\",\"description\":\"Relé 5V para válvula solenoide.\",\"active\":%s,\"schedule\":",
                 is_ntp_synchronized() ? "true" : "false",
                 t.year, t.month, t.day, t.dotw, t.hour, t.min, t.sec,
                 irrigator_is_on() ? "true" : "false"
             );
 
-            for (int i = 0; i < IRRIGATOR_MAX_SCHEDULE_SIZE; i++) {
-                if (i > 0) offset += snprintf(response + offset, RX_BUFFER_SIZE - offset, ",");
-                offset += snprintf(response + offset, RX_BUFFER_SIZE - offset, 
-                    "{\"index\":%d,\"hour\":%d,\"minute\":%d,\"duration\":%d,\"active\":%d}",
-                    i, schedules[i].hour, schedules[i].minute, schedules[i].duration, schedules[i].active);
-            }
+            // Leaves room for the fields that follow the array
+            offset += irrigator_schedules_to_json(response + offset, RX_BUFFER_SIZE - offset - 512);
 
             offset += snprintf(response + offset, RX_BUFFER_SIZE - offset, 
-                "]},"
+                "},"
                 "\"led\":{\"name\":\"LED\",\"description\":\"Indica irrigação ativa.\"},"
                 "\"oled\":{\"name\":\"OLED\",\"description\":\"Display de status SSD1306.\"},"
-                "\"sensors\":{\"name\":\"AHT10\",\"description\":\"Sensor de Temp/Hum.\",\"humidity\":%.2f,\"temperature\":%.2f},"
+                "\"sensors\":{\"name\":\"AHT10\",\"description\":\"Sensor de Temp/Hum.\",\"humidity\":%s,\"temperature\":%s},"
                 "\"wifi\":{\"name\":\"Wi-Fi\",\"description\":\"Conexão sem fio.\",\"hasInternetConnection\":%s,\"ip\":\"%s\"}"
                 "},"
                 "\"system\":{\"os\":\"FreeRTOS\",\"version\":\"v1.0.1\"}"
@@ -317,6 +429,29 @@ static err_t http_recv_callback(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
                 ip_str
             );
 
+            http_send_response(pcb, response, 200);
+            free(response);
+        } else {
+            http_send_response(pcb, "{\"error\": \"memory\"}", 500);
+        }
+    } else if (strncmp(rx_buffer, "GET /irrigator/events", 21) == 0 && (rx_buffer[21] == ' ' || rx_buffer[21] == '?')) {
+        int page = get_query_int_value(rx_buffer, "page", 0);
+        int size = get_query_int_value(rx_buffer, "size", 10);
+        if (page < 0) page = 0;
+        if (size < 1 || size > EVENTS_MAX_PAGE_SIZE) size = EVENTS_MAX_PAGE_SIZE;
+
+        char *response = malloc(RX_BUFFER_SIZE);
+        if (response) {
+            build_events_json(response, RX_BUFFER_SIZE, page, size);
+            http_send_response(pcb, response, 200);
+            free(response);
+        } else {
+            http_send_response(pcb, "{\"error\": \"memory\"}", 500);
+        }
+    } else if (strncmp(rx_buffer, "GET /irrigator/totals ", 22) == 0) {
+        char *response = malloc(RX_BUFFER_SIZE);
+        if (response) {
+            build_totals_json(response, RX_BUFFER_SIZE);
             http_send_response(pcb, response, 200);
             free(response);
         } else {
@@ -327,18 +462,22 @@ static err_t http_recv_callback(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
         if (body) {
             body += 4; // Skip CRLFCRLF
             bool active = get_json_bool_value(body, "active", false);
-            
-            if (active) {
-                int duration = get_json_int_value(body, "duration", 60);
-                if (duration > 360) duration = 360; // Max 6 min
-                
-                irrigator_set_remote_duration(duration);
-                xTaskNotify(irrigator_task_handle, IRRIGATOR_REMOTE_TURN_ON, eSetValueWithOverwrite);
+            int duration = get_json_int_value(body, "duration", 60);
+            int zone = get_json_int_value(body, "zone", active ? 0 : -1);
+
+            // lwIP callbacks run in interrupt context
+            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+            if (!irrigator_zone_valid(zone)) {
+                http_send_response(pcb, "{\"error\": \"invalid zone\"}", 400);
+            } else if (!irrigator_send_command_from_isr(active ? IRRIGATOR_TURN_ON : IRRIGATOR_TURN_OFF,
+                    IRRIGATOR_SOURCE_LOCAL_API, zone, duration, &xHigherPriorityTaskWoken)) {
+                http_send_response(pcb, "{\"error\": \"busy\"}", 503);
+            } else if (active) {
                 http_send_response(pcb, "{\"status\": \"irrigator on\"}", 200);
             } else {
-                xTaskNotify(irrigator_task_handle, IRRIGATOR_REMOTE_TURN_OFF, eSetValueWithOverwrite);
                 http_send_response(pcb, "{\"status\": \"irrigator off\"}", 200);
             }
+            portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
         } else {
             http_send_response(pcb, "{\"error\": \"no body\"}", 400);
         }
@@ -347,18 +486,27 @@ static err_t http_recv_callback(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
         if (body) {
             body += 4; // Skip CRLFCRLF
             int index = get_json_int_value(body, "index", -1);
-            
-            if (index >= 0 && index < IRRIGATOR_MAX_SCHEDULE_SIZE) {
-                int hour = get_json_int_value(body, "hour", 0);
-                int minute = get_json_int_value(body, "minute", 0);
-                int duration = get_json_int_value(body, "duration", 60);
-                int active = get_json_int_value(body, "active", 1);
-
-                irrigator_set_schedule(index, (uint8_t)hour, (uint8_t)minute, (uint8_t)duration, (uint8_t)active);
+            int zone = get_json_int_value(body, "zone", 0);
+            schedule_item_t item = {
+                .hour = (uint8_t)get_json_int_value(body, "hour", 0),
+                .minute = (uint8_t)get_json_int_value(body, "minute", 0),
+                .duration = (uint16_t)irrigator_clamp_duration(get_json_int_value(body, "duration", 60)),
+                .active = (uint8_t)get_json_int_value(body, "active", 1),
+                .zone = (uint8_t)zone,
+                .days = (uint8_t)get_json_int_value(body, "days", SCHEDULE_EVERY_DAY),
+                .season_start = (uint16_t)get_json_int_value(body, "seasonStart", 0),
+                .season_end = (uint16_t)get_json_int_value(body, "seasonEnd", 0),
+            };
+
+            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+            if (zone < 0 || zone >= IRRIGATOR_ZONE_COUNT) {
+                http_send_response(pcb, "{\"error\": \"invalid zone\"}", 400);
+            } else if (irrigator_set_schedule_from_isr(index, &item, &xHigherPriorityTaskWoken)) {
                 http_send_response(pcb, "{\"status\": \"schedule updated\"}", 200);
             } else {
                 http_send_response(pcb, "{\"error\": \"invalid index\"}", 400);
             }
+            portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
         } else {
             http_send_response(pcb, "{\"error\": \"no body\"}", 400);
         }
@@ -65,19 +65,15 @@ void gpio_callback(uint gpio, uint32_t events) {
         // Debounce Button A
         if (now - last_a_time > DEBOUNCE_TIME_MS) {
             last_a_time = now;
-            // Notify Irrigator Task to Turn ON (Action 1)
-            if (irrigator_task_handle != NULL) {
-                xTaskNotifyFromISR(irrigator_task_handle, 1, eSetValueWithOverwrite, &xHigherPriorityTaskWoken);
-            }
+            // Queue a Turn ON for the Irrigator Task
+            irrigator_send_command_from_isr(IRRIGATOR_TURN_ON, IRRIGATOR_SOURCE_BUTTON, 0, 0, &xHigherPriorityTaskWoken);
         }
     } else if (gpio == BUTTON_B_PIN) {
         // Debounce Button B
         if (now - last_b_time > DEBOUNCE_TIME_MS) {
             last_b_time = now;
-            // Notify Irrigator Task to Turn OFF (Action 2)
-            if (irrigator_task_handle != NULL) {
-                xTaskNotifyFromISR(irrigator_task_handle, 2, eSetValueWithOverwrite, &xHigherPriorityTaskWoken);
-            }
+            // Queue a Turn OFF (every zone) for the Irrigator Task
+            irrigator_send_command_from_isr(IRRIGATOR_TURN_OFF, IRRIGATOR_SOURCE_BUTTON, -1, 0, &xHigherPriorityTaskWoken);
         }
     }
 
@@ -1,6 +1,6 @@
 /**
  * @file clock.c
- * @brief Implementation of clock functionality using RP2040 RTC.
+ * @brief Implementation of clock functionality over the 64-bit microsecond timer.
  *
  * @author Robson Gomes
  * @email robson.mesquita56@gmail.com
@@ -8,10 +8,8 @@
  */
 
 #include "clock.h"
-#include "hardware/rtc.h"
 #include "pico/stdlib.h"
 #include <stdio.h>
-#include <time.h>
 #include <string.h>
 
 #include "pico/cyw43_arch.h"
@@ -19,32 +17,50 @@
 #include "lwip/pbuf.h"
 #include "lwip/udp.h"
 #include "wifi_connection.h"
+#include "irrigator.h"
+#include "schedule.h"
+#include "seqlock.h"
+#include "ntp.h"
+#include "tz.h"
+#include <limits.h>
+#include <stdint.h>
 #include "FreeRTOS.h"
 #include "task.h"
 
 static u_int8_t ntp_synchronized = 0;
+static bool ever_synchronized = false; // a hora padrão de clock_init() já foi corrigida
 
-// --- Implementação RTC ---
+// --- Implementação do relógio ---
 
+#define SECONDS_1970_TO_2000 946684800LL
 
-void clock_init(void)
+typedef struct
 {
-    rtc_init();
+    int64_t offset_us;     // época UTC em µs = time_us_64() + offset_us + ajuste gradual aplicado
+    uint64_t slew_start;   // time_us_64() no início do ajuste gradual
+    int64_t slew_us;       // total do ajuste gradual (com sinal), 0 se nenhum
+    uint64_t freq_start;   // time_us_64() desde o qual a correção de frequência acumula
+    int32_t freq_ppb;      // correção de frequência do cristal
+    int64_t cached_second; // segundo UTC de `cached`, -1 se inválido
+    datetime_t cached;
+} clock_state_t;
+
+// Escrito pela tarefa NTP, pelo callback do lwIP e lido de qualquer contexto
+static clock_state_t state = { .cached_second = -1 };
+static seqlock_t state_lock = SEQLOCK_INIT;
 
-    // Configura uma data/hora inicial padrão (Segunda, 01/01/2024 12:00:00)
-    // Isso garante que o RTC comece a contar se ainda não estiver rodando.
+void clock_init(void)
+{
+    // Data/hora inicial padrão (Segunda, 01/01/2024 12:00:00), até o NTP
     datetime_t t = {
         .year  = 2024,
         .month = 1,
         .day   = 1,
-        .dotw  = 1, // Segunda-feira
         .hour  = 12,
         .min   = 0,
         .sec   = 0
     };
-
-    // Inicializa o RTC com a data definida
-    rtc_set_datetime(&t);
+    clock_set_time(&t);
 }
 
 bool is_ntp_synchronized(void)
@@ -52,80 +68,314 @@ bool is_ntp_synchronized(void)
     return ntp_synchronized;
 }
 
+// Deslocamento em `now`, com a correção de frequência acumulada e a parte
+// já aplicada do ajuste gradual
+static int64_t offset_at(const clock_state_t *st, uint64_t now)
+{
+    int64_t offset = st->offset_us + (int64_t)((now - st->freq_start) / 1000) * st->freq_ppb / 1000000; // em ms: sem estouro mesmo após anos
+    int64_t applied = (int64_t)(now - st->slew_start) * CLOCK_SLEW_RATE_PPM / 1000000;
+    if (st->slew_us >= 0)
+        return offset + (applied < st->slew_us ? applied : st->slew_us);
+    return offset - (applied < -st->slew_us ? applied : -st->slew_us);
+}
+
+static int64_t now_epoch_us(void)
+{
+    clock_state_t current;
+    uint64_t now;
+    uint32_t seq;
+    do
+    {
+        seq = seqlock_read_begin(&state_lock);
+        current.offset_us = state.offset_us; // acessos de 32 bits no M0+
+        current.slew_start = state.slew_start;
+        current.slew_us = state.slew_us;
+        current.freq_start = state.freq_start;
+        current.freq_ppb = state.freq_ppb;
+    } while (seqlock_read_retry(&state_lock, seq));
+
+    now = time_us_64();
+    return (int64_t)now + offset_at(&current, now);
+}
+
+int64_t clock_now_epoch_ms(void)
+{
+    return now_epoch_us() / 1000;
+}
+
+void clock_set_epoch_ms(int64_t epoch_ms)
+{
+    uint32_t saved = seqlock_write_begin(&state_lock);
+    uint64_t now = time_us_64();
+    state.offset_us = epoch_ms * 1000 - (int64_t)now;
+    state.freq_start = now;
+    state.slew_us = 0;
+    state.cached_second = -1;
+    seqlock_write_end(&state_lock, saved);
+}
+
+// Corrige o relógio em offset_us: salta se a diferença for grande (ou se
+// step), senão ajusta aos poucos, sem nunca voltar no tempo. freq_ppb passa
+// a ser a correção de frequência.
+// Retorna true se saltou.
+static bool clock_adjust_us(int64_t offset_us, int32_t freq_ppb, bool step)
+{
+    if (offset_us > CLOCK_STEP_THRESHOLD_US || offset_us < -CLOCK_STEP_THRESHOLD_US)
+        step = true;
+
+    uint32_t saved = seqlock_write_begin(&state_lock);
+    uint64_t now = time_us_64();
+    state.offset_us = offset_at(&state, now); // o que já foi aplicado fica
+    state.freq_start = now;
+    state.freq_ppb = freq_ppb;
+    state.slew_start = now;
+    state.slew_us = 0;
+    if (step)
+        state.offset_us += offset_us;
+    else
+        state.slew_us = offset_us;
+    state.cached_second = -1;
+    seqlock_write_end(&state_lock, saved);
+    return step;
+}
+
+bool clock_set_time(const datetime_t *t)
+{
+    if (t->month < 1 || t->month > 12 || t->day < 1 || t->hour < 0 || t->hour > 23 ||
+        t->min < 0 || t->min > 59 || t->sec < 0 || t->sec > 59)
+        return false;
+
+    int32_t days = schedule_days_from_date(t->year, t->month, t->day);
+    int year, month, day;
+    schedule_date_from_days(days, &year, &month, &day);
+    if (days < 0 || month != t->month || day != t->day)
+        return false; // 31/04, 29/02 fora de ano bissexto, antes de 2000
+
+    int64_t local_s = SECONDS_1970_TO_2000 + (int64_t)days * 86400 + t->hour * 3600 + t->min * 60 + t->sec;
+    clock_set_epoch_ms(tz_local_to_utc(local_s) * 1000);
+    return true;
+}
+
+int64_t clock_seconds_to_offset_change(void)
+{
+    return tz_seconds_to_next_change(clock_now_epoch_ms() / 1000);
+}
+
 bool clock_get_time(datetime_t *t)
 {
-    return rtc_get_datetime(t);
+    clock_state_t current;
+    seqlock_read(&state_lock, &current, &state, sizeof(current));
+
+    uint64_t now = time_us_64();
+    int64_t utc_s = ((int64_t)now + offset_at(&current, now)) / 1000000;
+    if (utc_s == current.cached_second)
+    {
+        *t = current.cached; // mesmo segundo: nada a recalcular
+        return true;
+    }
+
+    // Fuso e horário de verão de tz.h, uma vez por segundo
+    int64_t since_2000 = utc_s + tz_offset_at(utc_s) - SECONDS_1970_TO_2000;
+    if (since_2000 < 0)
+        return false;
+
+    // Campos a partir dos minutos de schedule_date_of(), que já calcula dotw
+    schedule_date_of((uint32_t)(since_2000 / 60), t);
+    t->sec = (int8_t)(since_2000 % 60);
+
+    // A data de um segundo não depende do deslocamento que levou a ele
+    uint32_t saved = seqlock_write_begin(&state_lock);
+    state.cached_second = utc_s;
+    state.cached = *t;
+    seqlock_write_end(&state_lock, saved);
+    return true;
 }
 
 // --- Implementação NTP ---
 
-#define NTP_SERVER "pool.ntp.org"
-#define NTP_MSG_LEN 48
-#define NTP_PORT 123
-#define NTP_DELTA 2208988800 // Segundos entre 1900 e 1970
-#define TIMEZONE_OFFSET (-3 * 3600) // UTC-3 (Brasília)
+static const char *const ntp_servers[] = NTP_SERVERS;
+#define NTP_SERVER_COUNT ((int)(sizeof(ntp_servers) / sizeof(ntp_servers[0])))
+
+typedef struct {
+    ip_addr_t addr;
+    bool resolved;
+    bool resolving;    // consulta DNS sem resposta
+    uint64_t t1;       // carimbo de envio do pedido em curso, 0 se nenhum
+    ntp_sample_t best; // amostra de menor atraso da rodada
+} ntp_peer_t;
 
+// Acessados no contexto do lwIP; a tarefa só os lê entre cyw43_arch_lwip_begin/end
+static ntp_peer_t peers[NTP_SERVER_COUNT];
+static struct udp_pcb *ntp_pcb = NULL;
+static volatile int ntp_in_flight = 0; // pedidos e consultas DNS sem resposta
 static TaskHandle_t sync_task_handle = NULL;
 
+// Disciplina do relógio; só a tarefa de sincronização escreve, e lê sem trava.
+// Os outros leem pelo seqlock, inclusive do contexto do lwIP (GET /status)
+static clock_sync_info_t sync_info = { .poll_s = NTP_POLL_INITIAL_S };
+static seqlock_t sync_info_lock = SEQLOCK_INIT;
+static uint64_t last_sync_us = 0; // time_us_64() da última sincronização sem salto, 0 se nenhuma
+
+static void ntp_wake_task(void) {
+    if (sync_task_handle) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xTaskNotifyFromISR(sync_task_handle, 0, eNoAction, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+static void ntp_send(int i) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NTP_MSG_LEN, PBUF_RAM);
+    if (!p) return;
+
+    // T1 o mais perto possível do envio
+    peers[i].t1 = ntp_from_epoch_us(now_epoch_us());
+    ntp_build_request((uint8_t *)p->payload, peers[i].t1);
+    if (udp_sendto(ntp_pcb, p, &peers[i].addr, NTP_PORT) == ERR_OK) {
+        ntp_in_flight++;
+    } else {
+        peers[i].t1 = 0;
+    }
+    pbuf_free(p);
+}
+
 // Callback chamado quando a resposta NTP é recebida
 static void ntp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
-    if (p && p->tot_len == NTP_MSG_LEN) {
-        uint8_t mode = pbuf_get_at(p, 0) & 0x07;
-        // Mode 4 é server
-        if (mode == 4) {
-            uint8_t seconds_buf[4];
-            pbuf_copy_partial(p, seconds_buf, 4, 40); // Transmit Timestamp começa no byte 40
-            
-            // Converte de Network Byte Order para Host
-            uint32_t seconds_since_1900 = (seconds_buf[0] << 24) | (seconds_buf[1] << 16) | (seconds_buf[2] << 8) | seconds_buf[3];
-            time_t epoch = seconds_since_1900 - NTP_DELTA;
-            epoch += TIMEZONE_OFFSET;
-
-            // Converte epoch para struct tm e depois para datetime_t
-            struct tm *tm_info = gmtime(&epoch);
-            datetime_t dt = {
-                .year  = tm_info->tm_year + 1900,
-                .month = tm_info->tm_mon + 1,
-                .day   = tm_info->tm_mday,
-                .dotw  = tm_info->tm_wday,
-                .hour  = tm_info->tm_hour,
-                .min   = tm_info->tm_min,
-                .sec   = tm_info->tm_sec
-            };
-
-            rtc_set_datetime(&dt);
-            
-            // Notifica a tarefa de sucesso
-            if (sync_task_handle) {
-                BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-                xTaskNotifyFromISR(sync_task_handle, 1, eSetValueWithOverwrite, &xHigherPriorityTaskWoken);
-                portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-            }
+    int64_t t4 = now_epoch_us(); // T4 antes de qualquer processamento
+    uint8_t msg[NTP_MSG_LEN];
+    size_t len = pbuf_copy_partial(p, msg, NTP_MSG_LEN, 0);
+    pbuf_free(p);
+
+    for (int i = 0; i < NTP_SERVER_COUNT; i++) {
+        if (peers[i].t1 == 0 || !ip_addr_cmp(addr, &peers[i].addr)) continue;
+
+        ntp_sample_t sample;
+        if (ntp_parse_reply(msg, len, peers[i].t1, t4, &sample)) {
+            ntp_filter(&peers[i].best, &sample);
+            peers[i].t1 = 0; // uma resposta por pedido
+            ntp_in_flight--;
+            ntp_wake_task();
         }
+        return;
     }
-    pbuf_free(p);
 }
 
-// Callback chamado quando o DNS resolve o IP do servidor NTP
+// Callback chamado quando o DNS resolve o IP de um servidor NTP
 static void ntp_dns_found(const char *hostname, const ip_addr_t *ipaddr, void *arg) {
-    if (ipaddr) {
-        struct udp_pcb *pcb = (struct udp_pcb *)arg;
-        
-        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NTP_MSG_LEN, PBUF_RAM);
-        uint8_t *req = (uint8_t *)p->payload;
-        memset(req, 0, NTP_MSG_LEN);
-        req[0] = 0x1B; // LI=0, VN=3, Mode=3 (Client)
-
-        udp_sendto(pcb, p, ipaddr, NTP_PORT);
-        pbuf_free(p);
-    } else {
-        // Falha no DNS
-         if (sync_task_handle) {
-            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-            xTaskNotifyFromISR(sync_task_handle, 0, eSetValueWithOverwrite, &xHigherPriorityTaskWoken);
-            portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    int i = (int)(intptr_t)arg;
+    peers[i].resolving = false;
+    ntp_in_flight--;
+
+    if (ipaddr && ntp_pcb) {
+        peers[i].addr = *ipaddr;
+        peers[i].resolved = true;
+        ntp_send(i);
+    }
+    ntp_wake_task();
+}
+
+// Uma rodada: NTP_BURST pedidos a cada servidor, guardando a melhor amostra
+// de cada um, e a seleção do deslocamento em que a maioria concorda
+static bool ntp_round(int64_t *offset_us, int *agreeing) {
+    ntp_sample_t samples[NTP_SERVER_COUNT];
+
+    cyw43_arch_lwip_begin();
+    memset(peers, 0, sizeof(peers));
+    ntp_in_flight = 0;
+    ntp_pcb = udp_new();
+    if (ntp_pcb) udp_recv(ntp_pcb, ntp_recv, NULL);
+    cyw43_arch_lwip_end();
+    if (!ntp_pcb) return false;
+
+    for (int pass = 0; pass < NTP_BURST; pass++) {
+        cyw43_arch_lwip_begin();
+        // Pedidos da passada anterior sem resposta são abandonados (a resposta
+        // atrasada é descartada), senão cada passada seguinte esperaria o
+        // timeout inteiro por eles; só as consultas DNS continuam valendo
+        ntp_in_flight = 0;
+        for (int i = 0; i < NTP_SERVER_COUNT; i++) {
+            peers[i].t1 = 0;
+            if (peers[i].resolving) ntp_in_flight++;
+        }
+
+        for (int i = 0; i < NTP_SERVER_COUNT; i++) {
+            if (peers[i].resolved) {
+                ntp_send(i);
+            } else if (pass == 0) {
+                ip_addr_t ip;
+                peers[i].resolving = true;
+                ntp_in_flight++;
+                err_t err = dns_gethostbyname(ntp_servers[i], &ip, ntp_dns_found, (void *)(intptr_t)i);
+                if (err == ERR_OK) {
+                    // IP já estava em cache, chama callback manualmente
+                    ntp_dns_found(ntp_servers[i], &ip, (void *)(intptr_t)i);
+                } else if (err != ERR_INPROGRESS) {
+                    peers[i].resolving = false;
+                    ntp_in_flight--;
+                }
+            }
         }
+        cyw43_arch_lwip_end();
+
+        // Aguarda as respostas (ou o timeout) antes do próximo pedido
+        TickType_t start = xTaskGetTickCount();
+        TickType_t timeout = pdMS_TO_TICKS(NTP_REPLY_TIMEOUT_MS);
+        while (ntp_in_flight > 0 && xTaskGetTickCount() - start < timeout) {
+            xTaskNotifyWait(0, ULONG_MAX, NULL, timeout - (xTaskGetTickCount() - start));
+        }
+    }
+
+    cyw43_arch_lwip_begin();
+    for (int i = 0; i < NTP_SERVER_COUNT; i++) {
+        peers[i].t1 = 0; // respostas atrasadas são descartadas
+        samples[i] = peers[i].best;
+    }
+    udp_remove(ntp_pcb);
+    ntp_pcb = NULL;
+    cyw43_arch_lwip_end();
+
+    *agreeing = ntp_select(samples, NTP_SERVER_COUNT, offset_us);
+    return *agreeing > 0;
+}
+
+void clock_get_sync_info(clock_sync_info_t *info) {
+    seqlock_read(&sync_info_lock, info, &sync_info, sizeof(*info));
+}
+
+// Aprende a deriva com o erro medido desde a última sincronização, corrige
+// o relógio e ajusta o intervalo até a próxima. Retorna true se saltou.
+static bool clock_discipline(int64_t offset_us) {
+    clock_sync_info_t info = sync_info;
+    uint64_t now = time_us_64();
+    int64_t elapsed_us = last_sync_us ? (int64_t)(now - last_sync_us) : 0;
+
+    // O erro acumulado em `elapsed` é a frequência que ainda falta corrigir;
+    // metade por vez, para que uma amostra ruim não desvie muito a estimativa
+    int64_t freq = info.freq_ppb;
+    bool small = offset_us <= CLOCK_STEP_THRESHOLD_US && offset_us >= -CLOCK_STEP_THRESHOLD_US;
+    if (ever_synchronized && small && elapsed_us >= (int64_t)CLOCK_FREQ_MIN_INTERVAL_S * 1000000) {
+        freq += offset_us * 1000000000 / elapsed_us / 2;
+        if (freq > CLOCK_FREQ_MAX_PPB) freq = CLOCK_FREQ_MAX_PPB;
+        if (freq < -CLOCK_FREQ_MAX_PPB) freq = -CLOCK_FREQ_MAX_PPB;
     }
+
+    bool stepped = clock_adjust_us(offset_us, (int32_t)freq, !ever_synchronized);
+    last_sync_us = now; // após um salto a próxima medida parte daqui
+
+    // Erro pequeno frente ao alvo: dá para esperar mais; grande: sincroniza antes
+    int64_t error = offset_us < 0 ? -offset_us : offset_us;
+    if (stepped) {
+        info.poll_s = NTP_POLL_MIN_S;
+    } else if (error < CLOCK_TARGET_ACCURACY_US / 4) {
+        info.poll_s = info.poll_s * 2 > NTP_POLL_MAX_S ? NTP_POLL_MAX_S : info.poll_s * 2;
+    } else if (error > CLOCK_TARGET_ACCURACY_US / 2) {
+        info.poll_s = info.poll_s / 2 < NTP_POLL_MIN_S ? NTP_POLL_MIN_S : info.poll_s / 2;
+    }
+    info.freq_ppb = (int32_t)freq;
+    info.last_offset_us = (int32_t)(small ? offset_us : (offset_us > 0 ? INT32_MAX : INT32_MIN));
+
+    seqlock_write(&sync_info_lock, &sync_info, &info, sizeof(info));
+    return stepped;
 }
 
 void clock_sync_task(void *pvParameters) {
@@ -135,48 +385,29 @@ void clock_sync_task(void *pvParameters) {
         // Só tenta sincronizar se estiver conectado ao Wi-Fi
         if (wifi_is_connected()) {
             printf("Clock: Iniciando sincronização NTP...\n");
-            
-            cyw43_arch_lwip_begin();
-            struct udp_pcb *pcb = udp_new();
-            udp_recv(pcb, ntp_recv, NULL);
-            
-            ip_addr_t ip;
-            int err = dns_gethostbyname(NTP_SERVER, &ip, ntp_dns_found, pcb);
-            
-            if (err == ERR_OK) {
-                // IP já estava em cache, chama callback manualmente
-                ntp_dns_found(NTP_SERVER, &ip, pcb);
-            }
-            cyw43_arch_lwip_end();
-
-            // Aguarda notificação (timeout 10s)
-            uint32_t result = 0;
-            if (xTaskNotifyWait(0, 0, &result, pdMS_TO_TICKS(10000)) == pdTRUE) {
-                if (result == 1) {
-                    ntp_synchronized = 1;
-                    printf("Clock: Sincronizado com sucesso!\n");
-                    
-                    // Limpeza
-                    cyw43_arch_lwip_begin();
-                    udp_remove(pcb);
-                    cyw43_arch_lwip_end();
-
-                    // Sincronização bem sucedida, aguarda 24h antes da próxima
-                    vTaskDelay(pdMS_TO_TICKS(24 * 3600 * 1000));
-                    continue;
-                }
+
+            int64_t offset;
+            int agreeing;
+            if (ntp_round(&offset, &agreeing)) {
+                // A primeira sincronização sempre salta: a hora padrão não vale nada
+                bool stepped = clock_discipline(offset);
+                ever_synchronized = true;
+                ntp_synchronized = 1;
+                printf("Clock: Sincronizado com sucesso! %d servidores, %s %lld ms, deriva %ld ppb, próxima em %lu s\n",
+                       agreeing, stepped ? "salto de" : "ajuste gradual de", (long long)(offset / 1000),
+                       (long)sync_info.freq_ppb, (unsigned long)sync_info.poll_s);
+                if (stepped) irrigator_reschedule(); // o relógio saltou
+
+                vTaskDelay(pdMS_TO_TICKS(sync_info.poll_s * 1000));
+                continue;
             }
-            
-            // Timeout ou falha: Limpa PCB e tenta novamente mais tarde
-            cyw43_arch_lwip_begin();
-            udp_remove(pcb);
-            cyw43_arch_lwip_end();
+            printf("Clock: Falha na sincronização NTP.\n");
         } else {
             // Wi-Fi desconectado
             ntp_synchronized = 0;
         }
-        
+
         // Se falhou ou não conectado, tenta novamente em 1 minuto
-        vTaskDelay(pdMS_TO_TICKS(60000));
+        vTaskDelay(pdMS_TO_TICKS(NTP_RETRY_S * 1000));
     }
 }
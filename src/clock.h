@@ -2,6 +2,11 @@
  * @file clock.h
  * @brief Definitions for clock verify.
  *
+ * A hora é mantida como um deslocamento entre a época UTC e o contador de 64
+ * bits do timer (time_us_64()), sem ler o RTC: obter a hora é uma leitura do
+ * contador e uma soma. A data local decomposta é recalculada no máximo uma
+ * vez por segundo e reaproveitada pelos demais leitores.
+ *
  * @author Robson Gomes
  * @email robson.mesquita56@gmail.com
  * @github github.com/rob-ec
@@ -15,8 +20,37 @@
 #include "pico/util/datetime.h"
 #include "FreeRTOS.h"
 
+// Fuso horário e horário de verão: TZ_ZONE em tz.h
+
+// Servidores consultados a cada sincronização; a hora adotada é a da maioria que concorda
+#define NTP_SERVERS { "0.pool.ntp.org", "1.pool.ntp.org", "2.pool.ntp.org", "a.st1.ntp.br" }
+#define NTP_BURST 3                 // pedidos por servidor e rodada (vale o de menor atraso)
+#define NTP_REPLY_TIMEOUT_MS 2000   // espera por resposta de cada pedido
+
+#define CLOCK_STEP_THRESHOLD_US 128000 // diferenças maiores saltam; menores são ajustadas aos poucos
+#define CLOCK_SLEW_RATE_PPM 500        // velocidade do ajuste gradual (128 ms levam ~4 min)
+
+// Correção de frequência do cristal, aprendida entre sincronizações
+#define CLOCK_FREQ_MAX_PPB 500000      // ±500 ppm; além disso é falha, não deriva
+#define CLOCK_FREQ_MIN_INTERVAL_S 600  // intervalo mínimo entre sincronizações para medir a deriva
+
+// Intervalo entre sincronizações: dobra enquanto o erro medido fica abaixo de
+// um quarto do alvo e cai pela metade quando passa da metade dele
+#define CLOCK_TARGET_ACCURACY_US 50000
+#define NTP_POLL_MIN_S (16 * 60)
+#define NTP_POLL_MAX_S (36 * 3600)
+#define NTP_POLL_INITIAL_S 3600
+#define NTP_RETRY_S 60                 // após falha ou sem Wi-Fi
+
+typedef struct
+{
+    int32_t freq_ppb;       // correção de frequência aplicada
+    uint32_t poll_s;        // intervalo até a próxima sincronização
+    int32_t last_offset_us; // erro medido na última sincronização
+} clock_sync_info_t;
+
 /**
- * @brief Inicializa o RTC (Real Time Clock).
+ * @brief Inicializa o relógio com uma data padrão, até a sincronização NTP.
  */
 void clock_init(void);
 
@@ -26,12 +60,38 @@ void clock_init(void);
 bool is_ntp_synchronized(void);
 
 /**
- * @brief Obtém a data e hora atuais do RTC.
+ * @brief Milissegundos desde 1970-01-01 UTC. O(1), seguro em interrupções.
+ */
+int64_t clock_now_epoch_ms(void);
+
+/**
+ * @brief Acerta o relógio (época UTC em milissegundos). Seguro em interrupções.
+ */
+void clock_set_epoch_ms(int64_t epoch_ms);
+
+/**
+ * @brief Acerta o relógio a partir de uma data local; dotw é calculado.
+ * @return false se a data for inválida.
+ */
+bool clock_set_time(const datetime_t *t);
+
+/**
+ * @brief Segundos até a próxima mudança de horário de verão, -1 se o fuso não tem.
+ */
+int64_t clock_seconds_to_offset_change(void);
+
+/**
+ * @brief Obtém a data e hora locais atuais (fuso de tz.h).
  * @param t Ponteiro para a estrutura datetime_t onde os dados serão preenchidos.
  * @return true se a leitura for bem sucedida, false caso contrário.
  */
 bool clock_get_time(datetime_t *t);
 
+/**
+ * @brief Estado da disciplina do relógio (deriva aprendida e intervalo de sincronização).
+ */
+void clock_get_sync_info(clock_sync_info_t *info);
+
 /**
  * @brief Tarefa que sincroniza o relógio via NTP quando há Wi-Fi.
  * @param pvParameters Parâmetros da tarefa (não utilizado).
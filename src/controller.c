@@ -0,0 +1,254 @@
+/**
+ * @file controller.c
+ * @brief Implementation of the irrigation controller logic.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "controller.h"
+#include <string.h>
+
+void controller_init(controller_t *c, const schedule_store_t *const volatile *store, const seqlock_t *store_lock, int zone_count, int capacity)
+{
+    memset(c, 0, sizeof(*c));
+    zones_init(&c->zones, zone_count, capacity);
+    c->missed_policy = CONTROLLER_MISSED_RUN_LATE;
+    c->catchup_window_min = 60;
+    c->store = store;
+    c->store_lock = store_lock;
+}
+
+bool controller_request(controller_t *c, int zone, uint16_t duration_s, uint8_t source, uint32_t now_ms)
+{
+    if (!zones_request(&c->zones, zone, (uint32_t)duration_s * 1000, now_ms))
+        return false;
+
+    const zone_state_t *z = &c->zones.zones[zone];
+    controller_run_t *run = &c->runs[zone];
+    if (c->open_mask & (1u << zone))
+    {
+        // Merged into the open run: planned length now spans both
+        run->planned_s = z->until_stopped ? 0 : (uint16_t)((z->close_at - run->started_ms + 500) / 1000);
+    }
+    else
+    {
+        run->source = source;
+        run->planned_s = z->until_stopped ? 0 : (uint16_t)((z->open ? z->close_at - now_ms : z->queued_ms) / 1000);
+    }
+    return true;
+}
+
+void controller_stop(controller_t *c, int zone)
+{
+    zones_stop(&c->zones, zone);
+}
+
+uint32_t controller_open_mask(const controller_t *c)
+{
+    return zones_open_mask(&c->zones);
+}
+
+// Copies the first ZONES_MAX entries due at t, consistent even if the store
+// is being written. Returns how many are due, which may be more.
+static int read_due(const controller_t *c, const datetime_t *t, uint16_t *entries, schedule_item_t *items)
+{
+    int due;
+    uint32_t seq = 0;
+
+    do
+    {
+        if (c->store_lock != NULL)
+            seq = seqlock_read_begin(c->store_lock);
+        const schedule_store_t *store = *c->store;
+        due = schedule_store_due(store, t, entries, ZONES_MAX);
+        for (int i = 0; i < due && i < ZONES_MAX; i++)
+            items[i] = store->entries[entries[i]];
+    } while (c->store_lock != NULL && seqlock_read_retry(c->store_lock, seq));
+
+    return due;
+}
+
+static int32_t minutes_to_next(const controller_t *c, const datetime_t *t, bool skip_current)
+{
+    int32_t minutes;
+    uint32_t seq = 0;
+
+    do
+    {
+        if (c->store_lock != NULL)
+            seq = seqlock_read_begin(c->store_lock);
+        minutes = schedule_store_minutes_to_next(*c->store, t, skip_current);
+    } while (c->store_lock != NULL && seqlock_read_retry(c->store_lock, seq));
+
+    return minutes;
+}
+
+static void report(controller_result_t *result, const controller_event_t *event)
+{
+    if (result->event_count < CONTROLLER_MAX_EVENTS)
+        result->events[result->event_count++] = *event;
+    else
+        result->events_lost++;
+}
+
+// Requests the runs of the entries starting at minute. A missed minute (one
+// the clock jumped over) goes through the policy instead of starting as is.
+static void start_minute(controller_t *c, uint32_t minute, bool missed, uint32_t late_s, uint32_t now_ms, controller_result_t *result)
+{
+    datetime_t d;
+    uint16_t entries[ZONES_MAX];
+    schedule_item_t items[ZONES_MAX];
+
+    schedule_date_of(minute, &d);
+    int count = read_due(c, &d, entries, items);
+    if (count > ZONES_MAX)
+    {
+        // More starts in one minute than zones: the rest are not started
+        result->starts_dropped += count - ZONES_MAX;
+        count = ZONES_MAX;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        controller_event_t event = {
+            .minute = minute,
+            .entry = entries[i],
+            .zone = items[i].zone,
+            .action = missed ? CONTROLLER_STARTED_LATE : CONTROLLER_STARTED,
+            .duration_s = items[i].duration,
+            .late_s = late_s,
+        };
+
+        if (missed && c->missed_policy == CONTROLLER_MISSED_SKIP)
+        {
+            event.action = CONTROLLER_SKIPPED;
+        }
+        else if (missed && c->missed_policy == CONTROLLER_MISSED_SHORTEN)
+        {
+            if (late_s >= items[i].duration)
+            {
+                event.action = CONTROLLER_SKIPPED; // would already have ended
+            }
+            else
+            {
+                event.action = CONTROLLER_SHORTENED;
+                event.duration_s = (uint16_t)(items[i].duration - late_s);
+            }
+        }
+
+        if (event.action != CONTROLLER_SKIPPED)
+            controller_request(c, event.zone, event.duration_s, CONTROLLER_SOURCE_SCHEDULE, now_ms);
+        report(result, &event);
+    }
+}
+
+// Handles the starts from minute `from` up to `to` (inclusive), all missed.
+// Walks from one start to the next, so the cost follows the number of
+// starts, not the length of the jump.
+static void catch_up(controller_t *c, uint32_t from, uint32_t to, const datetime_t *t, uint32_t now_ms, controller_result_t *result)
+{
+    uint32_t minute = from;
+    uint32_t now_minute = schedule_minute_of(t);
+
+    while (minute <= to)
+    {
+        datetime_t d;
+        schedule_date_of(minute, &d);
+        int32_t delta = minutes_to_next(c, &d, false);
+        if (delta < 0 || (uint32_t)delta > to - minute)
+            break;
+
+        minute += delta;
+        start_minute(c, minute, true, (now_minute - minute) * 60 + t->sec, now_ms, result);
+        minute++;
+    }
+}
+
+// Starts of the minutes not handled yet up to the minute of t, and the next wake up
+static void check_schedule(controller_t *c, const datetime_t *t, uint32_t now_ms, controller_result_t *result)
+{
+    uint32_t minute = schedule_minute_of(t);
+    uint32_t wall_s = minute * 60 + t->sec;
+
+    if (!c->clock_seen)
+    {
+        c->clock_seen = true;
+        c->next_minute = minute; // no history before the first reading
+    }
+    else
+    {
+        uint32_t expected = c->last_wall_s + (now_ms - c->last_mono_ms) / 1000;
+        int32_t jump = (int32_t)(wall_s - expected);
+        if (jump > CONTROLLER_JUMP_TOLERANCE_S || jump < -CONTROLLER_JUMP_TOLERANCE_S)
+            result->clock_jump_s = jump;
+
+        // Far back (a bad clock corrected, a reset RTC): holding every start
+        // until the old time comes back would stop irrigation for that long
+        if (minute + CONTROLLER_REPEAT_WINDOW_MIN < c->next_minute)
+            c->next_minute = minute;
+    }
+    c->last_wall_s = wall_s;
+    c->last_mono_ms = now_ms;
+
+    if (minute >= c->next_minute)
+    {
+        uint32_t from = c->next_minute;
+        if (minute - from > c->catchup_window_min)
+        {
+            result->dropped_min = minute - from - c->catchup_window_min;
+            from = minute - c->catchup_window_min;
+        }
+
+        if (from < minute)
+            catch_up(c, from, minute - 1, t, now_ms, result);
+        start_minute(c, minute, false, t->sec, now_ms, result);
+        c->next_minute = minute + 1;
+    }
+
+    // After a jump back, the next start is past the minutes already handled
+    uint32_t base = c->next_minute - 1;
+    datetime_t d;
+    schedule_date_of(base, &d);
+    int32_t minutes = minutes_to_next(c, &d, true);
+    result->next_start_s = minutes < 0 ? -1 : (int32_t)(base - minute + minutes) * 60 - t->sec;
+}
+
+void controller_step(controller_t *c, const datetime_t *t, uint32_t now_ms, controller_result_t *result)
+{
+    result->next_start_s = -1;
+    result->clock_jump_s = 0;
+    result->dropped_min = 0;
+    result->event_count = 0;
+    result->events_lost = 0;
+    result->starts_dropped = 0;
+
+    if (t != NULL)
+        check_schedule(c, t, now_ms, result);
+
+    uint32_t before = c->open_mask;
+    result->next_stop_ms = zones_update(&c->zones, now_ms);
+    result->open_mask = zones_open_mask(&c->zones);
+    result->opened = result->open_mask & ~before;
+    result->closed = before & ~result->open_mask;
+
+    for (int i = 0; i < c->zones.count; i++)
+    {
+        if (result->opened & (1u << i))
+            c->runs[i].started_ms = now_ms;
+    }
+    c->open_mask = result->open_mask;
+
+    // Every timed zone ending at that same millisecond closes together
+    result->ending_mask = 0;
+    if (result->next_stop_ms != ZONES_NO_DEADLINE)
+    {
+        for (int i = 0; i < c->zones.count; i++)
+        {
+            const zone_state_t *z = &c->zones.zones[i];
+            if (z->open && !z->until_stopped && z->close_at - now_ms == result->next_stop_ms)
+                result->ending_mask |= 1u << i;
+        }
+    }
+}
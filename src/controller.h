@@ -0,0 +1,134 @@
+/**
+ * @file controller.h
+ * @brief Definitions for the irrigation controller logic.
+ *
+ * Everything the irrigator task decides: which schedule entries start in the
+ * current minute, how requested runs go through the zone model, which valves
+ * must be open and when the task has to run again.
+ *
+ * Starts are tracked on an absolute minute line (schedule_minute_of()) by the
+ * first minute not handled yet, not by matching the current minute. When
+ * the clock jumps forward (NTP, POST /clock, or a task that woke late) the
+ * starts in the minutes jumped over are handled by the missed-start policy;
+ * when it jumps back, the minutes already handled do not start again. The
+ * millisecond clock is the monotonic reference that tells a jump from time
+ * that really passed, for the log.
+ *
+ * Pure logic on caller-supplied times (local date and a millisecond clock):
+ * no GPIO, no timers, no FreeRTOS. The irrigator task feeds it the local time and
+ * time since boot and drives the valves from the result; the same code runs
+ * on a host against a virtual clock, stepping straight from one deadline to
+ * the next, which plays months of schedules in a fraction of a second.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "schedule.h"
+#include "zones.h"
+#include "seqlock.h"
+
+#define CONTROLLER_SOURCE_SCHEDULE 3 // source recorded for runs the schedule starts
+
+// What to do with a start the clock jumped over
+#define CONTROLLER_MISSED_RUN_LATE 0  // full duration, starting now
+#define CONTROLLER_MISSED_SHORTEN 1   // only what is left of it, as if it had started on time
+#define CONTROLLER_MISSED_SKIP 2      // not run, only reported
+
+#define CONTROLLER_JUMP_TOLERANCE_S 5         // wall vs monotonic drift not reported as a jump
+#define CONTROLLER_REPEAT_WINDOW_MIN (24 * 60) // a longer jump back starts the minute line over
+#define CONTROLLER_MAX_EVENTS 16              // starts reported per step
+
+// What happened to each start in a step
+#define CONTROLLER_STARTED 0
+#define CONTROLLER_STARTED_LATE 1
+#define CONTROLLER_SHORTENED 2
+#define CONTROLLER_SKIPPED 3
+
+// What is known about each zone's current (or queued) run
+typedef struct
+{
+    uint8_t source;      // IRRIGATOR_SOURCE_... that requested it
+    uint16_t planned_s;  // 0 = until stopped
+    uint32_t started_ms; // when the valve opened
+} controller_run_t;
+
+typedef struct
+{
+    zones_t zones;
+    controller_run_t runs[ZONES_MAX];
+    uint32_t open_mask;            // open zones as of the last controller_step()
+    bool clock_seen;               // the fields below are valid
+    uint32_t next_minute;          // first schedule_minute_of() whose starts were not handled yet
+    uint32_t last_wall_s;          // local time at the last step, seconds since 2000
+    uint32_t last_mono_ms;         // and the millisecond clock then
+    uint8_t missed_policy;         // CONTROLLER_MISSED_..., RUN_LATE by default
+    uint16_t catchup_window_min;   // starts older than this are skipped whatever the policy
+    const schedule_store_t *const volatile *store; // the published store, swapped by writers under store_lock
+    const seqlock_t *store_lock;   // NULL when nothing writes the store concurrently
+} controller_t;
+
+typedef struct
+{
+    uint32_t minute;     // scheduled start, schedule_minute_of()
+    uint16_t entry;      // schedule index
+    uint8_t zone;
+    uint8_t action;      // CONTROLLER_STARTED...
+    uint16_t duration_s; // requested (shortened, or the entry's when skipped)
+    uint32_t late_s;     // from the scheduled start to the step
+} controller_event_t;
+
+typedef struct
+{
+    uint32_t open_mask;    // zones open after the step
+    uint32_t opened;       // zones that opened during the step
+    uint32_t closed;       // zones that closed during the step
+    uint32_t next_stop_ms; // ms until the next run ends, or ZONES_NO_DEADLINE
+    uint32_t ending_mask;  // zones ending at that same millisecond
+    int32_t next_start_s;  // s until the next schedule start, -1 if none or no clock
+    int32_t clock_jump_s;  // wall clock change not explained by the monotonic clock, 0 if none
+    uint32_t dropped_min;  // minutes jumped over beyond the catch-up window (not looked at)
+    int event_count;
+    int events_lost;       // handled but not reported, events[] was full
+    int starts_dropped;    // due in a minute beyond the first ZONES_MAX, neither started nor reported
+    controller_event_t events[CONTROLLER_MAX_EVENTS];
+} controller_result_t;
+
+/**
+ * @param store Pointer to the schedules to follow, read with what it points
+ * to through store_lock when not NULL.
+ */
+void controller_init(controller_t *c, const schedule_store_t *const volatile *store, const seqlock_t *store_lock, int zone_count, int capacity);
+
+/**
+ * @brief Requests a run of a zone (see zones_request()), applied by the next controller_step().
+ * @param duration_s 0 keeps the zone open until controller_stop().
+ * @return false if zone is out of range.
+ */
+bool controller_request(controller_t *c, int zone, uint16_t duration_s, uint8_t source, uint32_t now_ms);
+
+/**
+ * @brief Closes a zone and drops its queued run; zone < 0 stops every zone.
+ */
+void controller_stop(controller_t *c, int zone);
+
+/**
+ * @brief Zones open in the model, including requests not stepped yet.
+ */
+uint32_t controller_open_mask(const controller_t *c);
+
+/**
+ * @brief One pass of the irrigator task: starts the entries due since the
+ * last handled minute up to the minute of t (missed ones by the policy),
+ * closes ended runs and opens queued ones.
+ * @param t Current local time, or NULL while the clock is not set (schedules wait).
+ */
+void controller_step(controller_t *c, const datetime_t *t, uint32_t now_ms, controller_result_t *result);
+
+#endif // CONTROLLER_H
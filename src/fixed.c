@@ -0,0 +1,38 @@
+/**
+ * @file fixed.c
+ * @brief Implementation of the fixed-point formatter.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "fixed.h"
+
+int fixed_format(char *buffer, int32_t value, int decimals)
+{
+    char digits[FIXED_STR_SIZE];
+    int n = 0;
+    int len = 0;
+
+    // Unsigned so INT32_MIN negates cleanly
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+
+    // Digits backwards, at least one before the point
+    do
+    {
+        digits[n++] = (char)('0' + magnitude % 10); // hardware divider on the RP2040
+        magnitude /= 10;
+    } while (magnitude > 0 || n <= decimals);
+
+    if (value < 0)
+        buffer[len++] = '-';
+    while (n > 0)
+    {
+        if (n == decimals)
+            buffer[len++] = '.';
+        buffer[len++] = digits[--n];
+    }
+    buffer[len] = '\0';
+    return len;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file fixed.h
+ * @brief Decimal formatting of fixed-point integers.
+ *
+ * Sensor values travel as scaled integers (hundredths of °C and of %RH), so
+ * nothing on the path from the AHT10 to the OLED and the JSON responses
+ * needs the soft-float routines of the FPU-less M0+. This is the formatter
+ * every serializer uses for them, printed with "%s".
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+#define FIXED_STR_SIZE 13 // "-21474836.48" and the terminator
+
+/**
+ * @brief Writes value / 10^decimals with exactly `decimals` digits after the point.
+ * @param buffer At least FIXED_STR_SIZE bytes.
+ * @param decimals 0 to 9.
+ * @return Length written, without the terminator.
+ */
+int fixed_format(char *buffer, int32_t value, int decimals);
+
+#endif // FIXED_H
@@ -0,0 +1,86 @@
+/**
+ * @file flow.c
+ * @brief Implementation of the flow sensor counter.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "flow.h"
+#include "pico/stdlib.h"
+#include "hardware/pwm.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+static uint flow_slice = 0;
+static volatile uint32_t wraps = 0;    // 65536-pulse blocks, counted by the wrap IRQ
+static volatile uint64_t injected = 0; // pulses from flow_inject_pulses()
+
+static void flow_wrap_irq(void)
+{
+    // Shared with any other PWM slice using the wrap IRQ
+    if (pwm_get_irq_status_mask() & (1u << flow_slice))
+    {
+        pwm_clear_irq(flow_slice);
+        wraps++;
+    }
+}
+
+void flow_init(void)
+{
+    if (!FLOW_SENSOR_ENABLED)
+        return;
+
+    gpio_set_function(FLOW_SENSOR_PIN, GPIO_FUNC_PWM);
+    gpio_pull_up(FLOW_SENSOR_PIN); // open collector sensors
+    flow_slice = pwm_gpio_to_slice_num(FLOW_SENSOR_PIN);
+
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv_mode(&config, PWM_DIV_B_RISING);
+    pwm_config_set_clkdiv(&config, 1.0f);
+    pwm_config_set_wrap(&config, 0xFFFF);
+    pwm_init(flow_slice, &config, false);
+
+    pwm_clear_irq(flow_slice);
+    pwm_set_irq_enabled(flow_slice, true);
+    irq_add_shared_handler(PWM_IRQ_WRAP, flow_wrap_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(PWM_IRQ_WRAP, true);
+
+    pwm_set_enabled(flow_slice, true);
+}
+
+uint64_t flow_get_count(void)
+{
+    uint64_t hardware = 0;
+
+    if (FLOW_SENSOR_ENABLED)
+    {
+        // Counter and wrap count must come from the same side of a wrap
+        uint32_t saved = save_and_disable_interrupts();
+        uint16_t counter = pwm_get_counter(flow_slice);
+        uint32_t w = wraps;
+        if (pwm_get_irq_status_mask() & (1u << flow_slice))
+        {
+            // Wrapped after interrupts were masked: the IRQ has not counted it yet
+            w++;
+            counter = pwm_get_counter(flow_slice);
+        }
+        restore_interrupts(saved);
+        hardware = ((uint64_t)w << 16) | counter;
+    }
+
+    return hardware + injected;
+}
+
+void flow_inject_pulses(uint32_t pulses)
+{
+    uint32_t saved = save_and_disable_interrupts();
+    injected += pulses;
+    restore_interrupts(saved);
+}
+
+uint32_t flow_pulses_to_dl(uint64_t pulses)
+{
+    return (uint32_t)((pulses * 10 + FLOW_PULSES_PER_LITRE / 2) / FLOW_PULSES_PER_LITRE);
+}
@@ -0,0 +1,44 @@
+/**
+ * @file flow.h
+ * @brief Definitions for the flow sensor (Hall effect pulse meter) on the pump line.
+ *
+ * Pulses are counted by a PWM slice in counter mode (rising edges on its B
+ * input), so the CPU takes no interrupt per pulse: only one every 65536
+ * pulses, when the 16-bit counter wraps.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef FLOW_H
+#define FLOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FLOW_SENSOR_ENABLED true
+#define FLOW_SENSOR_PIN 9           // must be a PWM B input (odd GPIO)
+#define FLOW_PULSES_PER_LITRE 450   // YF-S201; check the sensor datasheet
+
+/**
+ * @brief Starts counting. Does nothing when FLOW_SENSOR_ENABLED is false.
+ */
+void flow_init(void);
+
+/**
+ * @brief Pulses counted since flow_init(), injected ones included.
+ */
+uint64_t flow_get_count(void);
+
+/**
+ * @brief Adds pulses as if the sensor had produced them (simulation without a sensor).
+ */
+void flow_inject_pulses(uint32_t pulses);
+
+/**
+ * @brief Converts pulses to decilitres.
+ */
+uint32_t flow_pulses_to_dl(uint64_t pulses);
+
+#endif // FLOW_H
@@ -0,0 +1,673 @@
+/**
+ * @file http_client.c
+ * @brief Implementation of the asynchronous HTTP client using lwIP altcp.
+ *
+ * Each slot runs its own DNS -> connect -> send -> receive sequence from lwIP
+ * callbacks. Callbacks only move the slot to SLOT_DONE and wake the owner task;
+ * parsing, retries and user callbacks happen in http_client_poll().
+ *
+ * @author Robson Gomes
+ */
+
+#include "http_client.h"
+#include "lzss.h"
+#include "lwip/tcp.h"
+#include "lwip/altcp_tcp.h"
+#include "lwip/altcp_tls.h"
+#include "lwip/dns.h"
+#include "mbedtls/ssl.h"
+#include "hardware/timer.h"
+#include "pico/cyw43_arch.h"
+#include "pico/rand.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#define REQUEST_HEADER_SIZE 768 // request line + Authorization + per-request headers
+
+// Largest write: altcp_mbedtls turns each write into one record and fails
+// the whole write if it does not fit one
+#define TX_CHUNK_MAX MBEDTLS_SSL_OUT_CONTENT_LEN
+
+// Record size asked of the server (max_fragment_length), to fit MBEDTLS_SSL_IN_CONTENT_LEN
+#if MBEDTLS_SSL_IN_CONTENT_LEN >= 16384
+#define TLS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_NONE
+#else
+#define TLS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#endif
+
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_RESOLVING,
+    SLOT_CONNECTING,
+    SLOT_RECEIVING,
+    SLOT_RETRY_WAIT,
+    SLOT_DONE, // attempt finished (response or failure), waiting for dispatch
+} slot_state_t;
+
+typedef struct {
+    volatile slot_state_t state;
+    http_request_params_t params;
+    struct altcp_pcb *pcb;
+    ip_addr_t server_ip;
+    bool failed;          // transport error or timeout on the current attempt
+    bool session_offered; // TLS: a saved session was offered for resumption
+    uint64_t connect_started_us;
+    uint8_t attempts;
+    TickType_t submitted_at;
+    TickType_t deadline;  // end of the current attempt, or start of the next one in SLOT_RETRY_WAIT
+
+    // Request as sent on the wire: per-request headers, the shared header
+    // template, then the body (params.body or tx_compressed). All three are
+    // written by reference, so lwIP may read them until tx_acked reaches
+    // tx_queued; a connection that ends before that is aborted, not closed.
+    char tx_headers[REQUEST_HEADER_SIZE];
+    int tx_headers_len;
+    const uint8_t *tx_body;
+    size_t tx_len;
+    size_t tx_queued;     // bytes of the three handed to altcp so far
+    size_t tx_acked;      // bytes of those acked by the server
+    uint8_t *tx_compressed;
+
+    // Response: raw headers followed by the decoded body
+    bool headers_done;
+    bool body_encoded;
+    bool body_truncated;
+    int body_start;
+    lzss_decoder_t decoder;
+    int response_pos;
+    char response[HTTP_CLIENT_RECV_BUFFER_SIZE];
+} http_slot_t;
+
+static http_slot_t slots[HTTP_CLIENT_MAX_REQUESTS];
+static char client_host[64] = {0};
+static char client_base_path[64] = {0};
+static uint16_t client_port;
+static char header_template[160] = {0}; // headers that are the same for every request
+static int header_template_len = 0;
+static TaskHandle_t owner_task;
+static bool server_accepts_encoding = false;
+
+// TLS: one client config and the last session, shared by all slots
+static bool client_use_tls = false;
+static struct altcp_tls_config *tls_config;
+static struct altcp_tls_session *tls_session;
+static bool tls_session_valid = false;
+static http_client_stats_t stats; // written by lwIP callbacks and the task, always under the lwIP lock
+
+// ALTCP_MBEDTLS_AUTHMODE (lwipopts.h): lowered only by allow_unverified
+int altcp_mbedtls_authmode = MBEDTLS_SSL_VERIFY_REQUIRED;
+
+static void *client_alloc(size_t size) {
+    cyw43_arch_lwip_begin();
+    stats.allocations++;
+    cyw43_arch_lwip_end();
+    return malloc(size);
+}
+
+static bool tick_reached(TickType_t now, TickType_t target) {
+    return (int32_t)(now - target) >= 0;
+}
+
+static bool slot_in_flight(const http_slot_t *slot) {
+    return slot->state == SLOT_RESOLVING || slot->state == SLOT_CONNECTING || slot->state == SLOT_RECEIVING;
+}
+
+// Called from lwIP callbacks, so uses the ISR-safe notification (same as clock.c)
+static void notify_owner(void) {
+    if (owner_task) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(owner_task, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+// Must be called with the lwIP lock held (lwIP callback or cyw43_arch_lwip_begin)
+static void detach_pcb(http_slot_t *slot, bool abort) {
+    struct altcp_pcb *pcb = slot->pcb;
+    slot->pcb = NULL;
+    if (!pcb) return;
+
+    altcp_arg(pcb, NULL);
+    altcp_sent(pcb, NULL);
+    altcp_recv(pcb, NULL);
+    altcp_err(pcb, NULL);
+
+    if (abort || altcp_close(pcb) != ERR_OK) {
+        altcp_abort(pcb);
+    }
+}
+
+static void complete_attempt(http_slot_t *slot, bool failed) {
+    if (failed) stats.failures++;
+    // A server may answer early (401, 413) and close before acking the whole
+    // request. Closing would leave segments pointing at the tx buffers, to be
+    // retransmitted after the slot reuses them; abort drops them.
+    detach_pcb(slot, failed || slot->tx_acked < slot->tx_queued);
+    slot->failed = failed;
+    slot->state = SLOT_DONE;
+    notify_owner();
+}
+
+static void build_header_template(void) {
+    header_template_len = snprintf(header_template, sizeof(header_template),
+        "Host: %s:%d\r\n"
+        "Content-Type: application/json\r\n"
+        "%s%s%s"
+        "Connection: close\r\n"
+        "\r\n",
+        client_host, client_port,
+        HTTP_CLIENT_ENABLE_COMPRESSION ? "Accept-Encoding: " : "",
+        HTTP_CLIENT_ENABLE_COMPRESSION ? HTTP_CLIENT_ENCODING : "",
+        HTTP_CLIENT_ENABLE_COMPRESSION ? "\r\n" : "");
+}
+
+// Only the parts that change per request; the rest comes from header_template
+static int format_headers(http_slot_t *slot) {
+    const http_request_params_t *p = &slot->params;
+    const char *token = p->bearer_token;
+    bool compressed = slot->tx_compressed != NULL;
+
+    return snprintf(slot->tx_headers, sizeof(slot->tx_headers),
+        "%s %s%s HTTP/1.1\r\n"
+        "%s%s%s"
+        "%s%s%s"
+        "Content-Length: %d\r\n",
+        p->method, client_base_path, p->path,
+        token ? "Authorization: Bearer " : "", token ? token : "", token ? "\r\n" : "",
+        compressed ? "Content-Encoding: " : "", compressed ? HTTP_CLIENT_ENCODING : "", compressed ? "\r\n" : "",
+        (int)slot->tx_len);
+}
+
+// True if the header block has a "name:" line whose value contains token
+static bool header_has_token(const char *headers, const char *name, const char *token) {
+    size_t name_len = strlen(name);
+    const char *line = headers;
+
+    while (line && *line) {
+        const char *end = strstr(line, "\r\n");
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *found = strstr(line + name_len + 1, token);
+            if (found && (!end || found < end)) return true;
+        }
+        line = end ? end + 2 : NULL;
+    }
+    return false;
+}
+
+static void on_headers_complete(http_slot_t *slot) {
+    slot->headers_done = true;
+    slot->body_start = slot->response_pos;
+    slot->response[slot->response_pos] = '\0';
+
+    if (!HTTP_CLIENT_ENABLE_COMPRESSION) return;
+
+    slot->body_encoded = header_has_token(slot->response, "Content-Encoding", HTTP_CLIENT_ENCODING);
+    if (slot->body_encoded || header_has_token(slot->response, "Accept-Encoding", HTTP_CLIENT_ENCODING)) {
+        server_accepts_encoding = true;
+    }
+    lzss_decoder_init(&slot->decoder);
+}
+
+// Appends received bytes: headers are copied verbatim, the body is decoded on the fly if needed
+static void receive_bytes(http_slot_t *slot, const uint8_t *data, u16_t len) {
+    int capacity = (int)sizeof(slot->response) - 1;
+    u16_t i = 0;
+
+    while (i < len && !slot->headers_done) {
+        if (slot->response_pos >= capacity) {
+            if (!slot->body_truncated) printf("HTTP Client: Response headers over %d B\n", capacity);
+            slot->body_truncated = true;
+            return;
+        }
+        slot->response[slot->response_pos++] = (char)data[i++];
+        if (slot->response_pos >= 4 && memcmp(slot->response + slot->response_pos - 4, "\r\n\r\n", 4) == 0) {
+            on_headers_complete(slot);
+        }
+    }
+    if (i == len || slot->body_truncated) return;
+
+    if (slot->body_encoded) {
+        size_t out_pos = (size_t)(slot->response_pos - slot->body_start);
+        if (!lzss_decode(&slot->decoder, data + i, len - i, (uint8_t *)slot->response + slot->body_start,
+                         &out_pos, (size_t)(capacity - slot->body_start))) {
+            printf("HTTP Client: Encoded body truncated or corrupt\n");
+            slot->body_truncated = true;
+        }
+        slot->response_pos = slot->body_start + (int)out_pos;
+    } else {
+        int space = capacity - slot->response_pos;
+        int n = (len - i < space) ? len - i : space;
+        memcpy(slot->response + slot->response_pos, data + i, n);
+        slot->response_pos += n;
+        if (n < len - i) {
+            printf("HTTP Client: Body truncated at %d B\n", capacity - slot->body_start);
+            slot->body_truncated = true;
+        }
+    }
+}
+
+static err_t client_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p, err_t err) {
+    http_slot_t *slot = (http_slot_t *)arg;
+
+    if (!p) {
+        // Connection closed by server: response complete
+        complete_attempt(slot, false);
+        return ERR_OK;
+    }
+
+    stats.bytes_received += p->tot_len;
+    for (struct pbuf *q = p; q; q = q->next) {
+        receive_bytes(slot, (const uint8_t *)q->payload, q->len);
+    }
+
+    altcp_recved(pcb, p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+// With TLS, "connected" fires after the handshake, so this measures TCP + handshake
+static void record_handshake(http_slot_t *slot, struct altcp_pcb *pcb) {
+    uint32_t elapsed_ms = (uint32_t)((time_us_64() - slot->connect_started_us) / 1000);
+
+    if (!tls_config) return;
+
+    if (slot->session_offered) {
+        stats.tls_resumed_handshakes++;
+        stats.tls_resumed_handshake_ms += elapsed_ms;
+    } else {
+        stats.tls_full_handshakes++;
+        stats.tls_full_handshake_ms += elapsed_ms;
+    }
+
+    // Keep the freshest session (ticket or ID) for the next connection
+    if (tls_session && altcp_tls_get_session(pcb, tls_session) == ERR_OK) {
+        tls_session_valid = true;
+    }
+}
+
+// Queues as much of the request as the connection takes, in chunks of at
+// most TX_CHUNK_MAX; client_sent() continues as acks free the send buffer
+static err_t send_request(http_slot_t *slot, struct altcp_pcb *pcb) {
+    const uint8_t *parts[3] = { (const uint8_t *)slot->tx_headers, (const uint8_t *)header_template, slot->tx_body };
+    size_t lens[3] = { (size_t)slot->tx_headers_len, (size_t)header_template_len, slot->tx_len };
+    size_t total = lens[0] + lens[1] + lens[2];
+    size_t start = 0;
+
+    for (int i = 0; i < 3; i++) {
+        size_t end = start + lens[i];
+        while (slot->tx_queued < end) {
+            size_t chunk = end - slot->tx_queued;
+            if (chunk > TX_CHUNK_MAX) chunk = TX_CHUNK_MAX;
+            if (chunk > altcp_sndbuf(pcb)) chunk = altcp_sndbuf(pcb);
+            if (chunk == 0) return ERR_OK;
+
+            u8_t flags = slot->tx_queued + chunk < total ? TCP_WRITE_FLAG_MORE : 0;
+            err_t err = altcp_write(pcb, parts[i] + (slot->tx_queued - start), (u16_t)chunk, flags);
+            if (err == ERR_MEM) return ERR_OK; // out of segments: retried on the next ack
+            if (err != ERR_OK) return err;
+
+            slot->tx_queued += chunk;
+            stats.bytes_sent += (uint32_t)chunk;
+        }
+        start = end;
+    }
+    return ERR_OK;
+}
+
+static err_t client_sent(void *arg, struct altcp_pcb *pcb, u16_t len) {
+    http_slot_t *slot = (http_slot_t *)arg;
+
+    slot->tx_acked += len;
+    err_t err = send_request(slot, pcb);
+    if (err != ERR_OK) {
+        printf("HTTP Client: Failed to send %s %s (err %d)\n", slot->params.method, slot->params.path, err);
+        complete_attempt(slot, true);
+        return ERR_ABRT;
+    }
+    altcp_output(pcb);
+    return ERR_OK;
+}
+
+static err_t client_connected(void *arg, struct altcp_pcb *pcb, err_t err) {
+    http_slot_t *slot = (http_slot_t *)arg;
+
+    if (err != ERR_OK) {
+        printf("HTTP Client: Connection failed %d\n", err);
+        complete_attempt(slot, true);
+        return ERR_ABRT;
+    }
+
+    record_handshake(slot, pcb);
+
+    // Enqueued by reference (no TCP_WRITE_FLAG_COPY), see tx_acked. TLS
+    // encrypts into its own buffer anyway.
+    err_t write_err = send_request(slot, pcb);
+
+    if (write_err != ERR_OK) {
+        printf("HTTP Client: Failed to send %s %s (err %d)\n", slot->params.method, slot->params.path, write_err);
+        complete_attempt(slot, true);
+        return ERR_ABRT;
+    }
+
+    slot->state = SLOT_RECEIVING;
+    altcp_output(pcb);
+    return ERR_OK;
+}
+
+static void client_err(void *arg, err_t err) {
+    http_slot_t *slot = (http_slot_t *)arg;
+    printf("HTTP Client: TCP Error %d\n", err);
+    if (!slot) return;
+
+    slot->pcb = NULL; // already freed by lwIP
+    if (slot->session_offered && slot->state == SLOT_CONNECTING) {
+        // The server may have refused to resume: next connection does a full handshake
+        tls_session_valid = false;
+    }
+    complete_attempt(slot, true);
+}
+
+static struct altcp_pcb *new_pcb(http_slot_t *slot) {
+    slot->session_offered = false;
+    if (!client_use_tls) return altcp_tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if (!tls_config) return NULL; // never fall back to plain TCP
+
+    struct altcp_pcb *pcb = altcp_tls_new(tls_config, IPADDR_TYPE_ANY);
+    if (!pcb) return NULL;
+
+    // SNI, and the certificate is checked against this name
+    mbedtls_ssl_context *ssl = altcp_tls_context(pcb);
+    mbedtls_ssl_set_hostname(ssl, client_host);
+
+    if (tls_session_valid && altcp_tls_set_session(pcb, tls_session) == ERR_OK) {
+        slot->session_offered = true;
+    }
+    return pcb;
+}
+
+static void start_connect(http_slot_t *slot) {
+    struct altcp_pcb *pcb = new_pcb(slot);
+    if (!pcb) {
+        complete_attempt(slot, true);
+        return;
+    }
+
+    slot->pcb = pcb;
+    slot->state = SLOT_CONNECTING;
+    altcp_arg(pcb, slot);
+    altcp_recv(pcb, client_recv);
+    altcp_sent(pcb, client_sent);
+    altcp_err(pcb, client_err);
+
+    slot->connect_started_us = time_us_64();
+    if (altcp_connect(pcb, &slot->server_ip, client_port, client_connected) != ERR_OK) {
+        complete_attempt(slot, true);
+    }
+}
+
+static void client_dns_found(const char *name, const ip_addr_t *ipaddr, void *callback_arg) {
+    http_slot_t *slot = (http_slot_t *)callback_arg;
+
+    // The attempt may have timed out while the lookup was pending
+    if (slot->state != SLOT_RESOLVING) return;
+
+    if (!ipaddr) {
+        printf("HTTP Client: DNS Failed\n");
+        complete_attempt(slot, true);
+        return;
+    }
+
+    slot->server_ip = *ipaddr;
+    start_connect(slot);
+}
+
+static void release_body(http_slot_t *slot) {
+    free(slot->tx_compressed);
+    slot->tx_compressed = NULL;
+}
+
+// Runs in task context, so the compression cost never lands in an lwIP callback
+static void prepare_body(http_slot_t *slot) {
+    const char *body = slot->params.body ? slot->params.body : "";
+    size_t len = strlen(body);
+
+    release_body(slot);
+    slot->tx_body = (const uint8_t *)body;
+    slot->tx_len = len;
+
+    if (!HTTP_CLIENT_ENABLE_COMPRESSION || !slot->params.compress_body ||
+        !server_accepts_encoding || len < HTTP_CLIENT_COMPRESS_MIN_SIZE) return;
+
+    uint8_t *compressed = client_alloc(len);
+    size_t compressed_len = compressed ? lzss_compress((const uint8_t *)body, len, compressed, len) : 0;
+    if (compressed_len == 0) {
+        free(compressed);
+        return;
+    }
+
+    slot->tx_compressed = compressed;
+    slot->tx_body = compressed;
+    slot->tx_len = compressed_len;
+}
+
+static void start_attempt(http_slot_t *slot) {
+    slot->attempts++;
+    slot->failed = false;
+    slot->headers_done = false;
+    slot->body_encoded = false;
+    slot->body_truncated = false;
+    slot->body_start = 0;
+    slot->response_pos = 0;
+    slot->tx_queued = 0;
+    slot->tx_acked = 0;
+    prepare_body(slot);
+
+    slot->tx_headers_len = format_headers(slot);
+    slot->deadline = xTaskGetTickCount() + pdMS_TO_TICKS(slot->params.timeout_ms);
+
+    cyw43_arch_lwip_begin();
+    stats.requests++;
+    if (slot->tx_headers_len <= 0 || slot->tx_headers_len >= (int)sizeof(slot->tx_headers)) {
+        printf("HTTP Client: Headers too long for %s %s\n", slot->params.method, slot->params.path);
+        stats.failures++;
+        slot->failed = true;
+        slot->state = SLOT_DONE;
+        cyw43_arch_lwip_end();
+        return;
+    }
+    slot->state = SLOT_RESOLVING;
+
+    err_t err = dns_gethostbyname(client_host, &slot->server_ip, client_dns_found, slot);
+    if (err == ERR_OK) {
+        // IP already cached
+        start_connect(slot);
+    } else if (err != ERR_INPROGRESS) {
+        printf("HTTP Client: DNS Error %d\n", err);
+        complete_attempt(slot, true);
+    }
+
+    cyw43_arch_lwip_end();
+}
+
+// Exponential backoff with "equal jitter": half of the window is fixed, half random
+static TickType_t backoff_delay(uint8_t attempts) {
+    uint32_t window = HTTP_CLIENT_BACKOFF_BASE_MS;
+    for (uint8_t i = 1; i < attempts && window < HTTP_CLIENT_BACKOFF_MAX_MS; i++) {
+        window *= 2;
+    }
+    if (window > HTTP_CLIENT_BACKOFF_MAX_MS) window = HTTP_CLIENT_BACKOFF_MAX_MS;
+
+    uint32_t delay = window / 2 + get_rand_32() % (window / 2 + 1);
+    return pdMS_TO_TICKS(delay);
+}
+
+static int parse_status(const char *response) {
+    if (strncmp(response, "HTTP/", 5) != 0) return 0;
+    const char *space = strchr(response, ' ');
+    return space ? atoi(space + 1) : 0;
+}
+
+static void finish_slot(http_slot_t *slot, TickType_t now) {
+    slot->response[slot->response_pos] = '\0';
+
+    http_response_t response = {0};
+    if (!slot->failed) {
+        response.status = parse_status(slot->response);
+        // A partial body would parse as valid JSON up to the cut: drop it
+        response.truncated = slot->body_truncated;
+        if (slot->headers_done && !slot->body_truncated) {
+            response.body = slot->response + slot->body_start;
+            response.body_len = slot->response_pos - slot->body_start;
+        }
+    }
+
+    bool retryable = response.status == 0 || response.status >= 500;
+    if (response.status == 415 && slot->tx_compressed) {
+        // Server stopped accepting the encoding: resend the plain body
+        printf("HTTP Client: %s rejected, falling back to plain bodies\n", HTTP_CLIENT_ENCODING);
+        server_accepts_encoding = false;
+        retryable = true;
+    }
+    if (retryable && slot->attempts <= slot->params.max_retries) {
+        TickType_t delay = backoff_delay(slot->attempts);
+        printf("HTTP Client: %s %s failed (status %d), retry %d in %lu ms\n",
+            slot->params.method, slot->params.path, response.status, slot->attempts,
+            (unsigned long)pdTICKS_TO_MS(delay));
+        slot->deadline = now + delay;
+        slot->state = SLOT_RETRY_WAIT;
+        return;
+    }
+
+    release_body(slot);
+    response.attempts = slot->attempts;
+    response.elapsed_ms = pdTICKS_TO_MS(now - slot->submitted_at);
+
+    // The slot stays reserved while the callback reads the response buffer
+    if (slot->params.on_done) {
+        slot->params.on_done(&response, slot->params.user);
+    }
+    slot->state = SLOT_FREE;
+}
+
+void http_client_init(const char *host, uint16_t port, const char *base_path, bool use_tls, const char *ca_cert, bool allow_unverified) {
+    strncpy(client_host, host, sizeof(client_host) - 1);
+    strncpy(client_base_path, base_path ? base_path : "", sizeof(client_base_path) - 1);
+    client_port = port;
+    owner_task = xTaskGetCurrentTaskHandle();
+    build_header_template();
+
+    client_use_tls = use_tls;
+    if (!use_tls) return;
+
+    if (!ca_cert && !allow_unverified) {
+        printf("HTTP Client: No CA certificate to verify the server, TLS requests will fail\n");
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    if (ca_cert) {
+        altcp_mbedtls_authmode = MBEDTLS_SSL_VERIFY_REQUIRED;
+        tls_config = altcp_tls_create_config_client((const u8_t *)ca_cert, strlen(ca_cert) + 1);
+    } else {
+        printf("HTTP Client: Unverified TLS allowed, server identity is NOT checked\n");
+        altcp_mbedtls_authmode = MBEDTLS_SSL_VERIFY_NONE;
+        tls_config = altcp_tls_create_config_client(NULL, 0);
+    }
+    if (tls_config) {
+        // Small records keep the input buffer at MBEDTLS_SSL_IN_CONTENT_LEN.
+        // altcp has no setter for this, but its config starts with the
+        // mbedtls_ssl_config every connection is set up from
+        mbedtls_ssl_conf_max_frag_len((mbedtls_ssl_config *)tls_config, TLS_MAX_FRAG_LEN);
+    }
+    tls_session = altcp_tls_alloc_session();
+    cyw43_arch_lwip_end();
+
+    if (!tls_config) {
+        printf("HTTP Client: Failed to create TLS config\n");
+    }
+}
+
+int http_client_submit(const http_request_params_t *params) {
+    for (int i = 0; i < HTTP_CLIENT_MAX_REQUESTS; i++) {
+        http_slot_t *slot = &slots[i];
+        if (slot->state != SLOT_FREE) continue;
+
+        slot->params = *params;
+        if (slot->params.timeout_ms == 0) slot->params.timeout_ms = HTTP_CLIENT_DEFAULT_TIMEOUT_MS;
+        slot->attempts = 0;
+        slot->tx_compressed = NULL;
+        slot->submitted_at = xTaskGetTickCount();
+        start_attempt(slot);
+        return i;
+    }
+
+    printf("HTTP Client: No free slot for %s %s\n", params->method, params->path);
+    return -1;
+}
+
+int http_client_pending(void) {
+    int count = 0;
+    for (int i = 0; i < HTTP_CLIENT_MAX_REQUESTS; i++) {
+        if (slots[i].state != SLOT_FREE) count++;
+    }
+    return count;
+}
+
+void http_client_get_stats(http_client_stats_t *out) {
+    cyw43_arch_lwip_begin();
+    *out = stats;
+    cyw43_arch_lwip_end();
+}
+
+void http_client_reset_stats(void) {
+    cyw43_arch_lwip_begin();
+    memset(&stats, 0, sizeof(stats));
+    cyw43_arch_lwip_end();
+}
+
+void http_client_poll(TickType_t max_wait) {
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = max_wait;
+
+    // Sleep no longer than the nearest timeout or retry
+    for (int i = 0; i < HTTP_CLIENT_MAX_REQUESTS; i++) {
+        http_slot_t *slot = &slots[i];
+        if (slot->state == SLOT_FREE) continue;
+
+        TickType_t remaining = 0;
+        if (slot->state != SLOT_DONE && !tick_reached(now, slot->deadline)) {
+            remaining = slot->deadline - now;
+        }
+        if (remaining < wait) wait = remaining;
+    }
+
+    ulTaskNotifyTake(pdTRUE, wait);
+    now = xTaskGetTickCount();
+
+    for (int i = 0; i < HTTP_CLIENT_MAX_REQUESTS; i++) {
+        http_slot_t *slot = &slots[i];
+
+        if (slot_in_flight(slot) && tick_reached(now, slot->deadline)) {
+            cyw43_arch_lwip_begin();
+            // Re-check under the lock: a callback may have completed it meanwhile
+            if (slot_in_flight(slot)) {
+                printf("HTTP Client: %s %s timed out\n", slot->params.method, slot->params.path);
+                detach_pcb(slot, true);
+                stats.failures++;
+                slot->failed = true;
+                slot->state = SLOT_DONE;
+            }
+            cyw43_arch_lwip_end();
+        }
+
+        if (slot->state == SLOT_RETRY_WAIT && tick_reached(now, slot->deadline)) {
+            start_attempt(slot);
+        }
+
+        if (slot->state == SLOT_DONE) {
+            finish_slot(slot, now);
+        }
+    }
+}
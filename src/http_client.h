@@ -0,0 +1,133 @@
+/**
+ * @file http_client.h
+ * @brief Definitions for the asynchronous HTTP client used by the global API.
+ *
+ * Requests live in a small fixed pool of slots, each with its own connection,
+ * response buffer, timeout and retry state, so several of them can be in flight
+ * at once. Completion callbacks always run in the context of the task that
+ * calls http_client_poll(), never inside lwIP callbacks.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define HTTP_CLIENT_MAX_REQUESTS 4            // login/events, sync, command poll, spare
+#define HTTP_CLIENT_RECV_BUFFER_SIZE 4096     // per request, headers included
+#define HTTP_CLIENT_DEFAULT_TIMEOUT_MS 10000  // per attempt
+#define HTTP_CLIENT_BACKOFF_BASE_MS 1000      // first retry waits about this long
+#define HTTP_CLIENT_BACKOFF_MAX_MS 60000      // retries never wait longer than this
+
+// Body compression (see lzss.h). Responses are decoded whenever the server
+// sends this Content-Encoding; request bodies are only compressed once the
+// server has advertised the encoding in an Accept-Encoding or Content-Encoding header.
+#define HTTP_CLIENT_ENABLE_COMPRESSION true
+#define HTTP_CLIENT_ENCODING "x-lzss"
+#define HTTP_CLIENT_COMPRESS_MIN_SIZE 128     // smaller bodies are sent as is
+
+/**
+ * @brief Result handed to a completion callback.
+ */
+typedef struct {
+    int status;          // HTTP status code, 0 if no response was received
+    const char *body;    // NUL-terminated body, NULL if none or truncated
+    int body_len;
+    bool truncated;      // the response did not fit HTTP_CLIENT_RECV_BUFFER_SIZE, body dropped
+    uint8_t attempts;    // attempts made, including the one that completed
+    uint32_t elapsed_ms; // from submission to completion, retries included
+} http_response_t;
+
+/**
+ * @brief Traffic counters, accumulated until http_client_reset_stats().
+ */
+typedef struct {
+    uint32_t requests;    // attempts started, retries included
+    uint32_t failures;    // attempts that ended without a response
+    uint32_t bytes_sent;  // headers and body, as written to TCP
+    uint32_t bytes_received;
+    uint32_t allocations; // heap allocations made by the client
+
+    // TLS handshakes (TCP connect included), split by whether a session was offered
+    uint32_t tls_full_handshakes;
+    uint32_t tls_full_handshake_ms;
+    uint32_t tls_resumed_handshakes;
+    uint32_t tls_resumed_handshake_ms;
+} http_client_stats_t;
+
+typedef void (*http_request_done_fn)(const http_response_t *response, void *user);
+
+/**
+ * @brief Parameters of a request.
+ *
+ * method, path, body and bearer_token are referenced, not copied: they must
+ * stay valid until the completion callback runs.
+ */
+typedef struct {
+    const char *method;
+    const char *path;          // appended to the base path given to http_client_init()
+    const char *body;          // NULL or "" for no body
+    const char *bearer_token;  // NULL to omit the Authorization header
+    uint32_t timeout_ms;       // 0 = HTTP_CLIENT_DEFAULT_TIMEOUT_MS
+    uint8_t max_retries;       // retried on transport errors and 5xx responses
+    bool compress_body;        // allow sending the body with HTTP_CLIENT_ENCODING
+    http_request_done_fn on_done;
+    void *user;
+} http_request_params_t;
+
+/**
+ * @brief Configures the server and binds the client to the calling task.
+ *
+ * With TLS, the session of the last successful handshake is offered on every
+ * new connection, so most connections skip the full asymmetric handshake.
+ *
+ * @param host Host name, resolved through DNS on every attempt (also used for SNI).
+ * @param port TCP port.
+ * @param base_path Path prefix for every request (may be "").
+ * @param use_tls Wrap connections in TLS (mbedTLS through altcp).
+ * @param ca_cert PEM CA certificate the server certificate must verify against.
+ * @param allow_unverified With no ca_cert, connect without verifying the server
+ * (still encrypted). Otherwise a TLS client without ca_cert fails every request.
+ */
+void http_client_init(const char *host, uint16_t port, const char *base_path, bool use_tls, const char *ca_cert, bool allow_unverified);
+
+/**
+ * @brief Queues a request and starts it immediately.
+ * @return Request id (>= 0), or -1 if every slot is busy.
+ */
+int http_client_submit(const http_request_params_t *params);
+
+/**
+ * @brief Number of requests currently in flight or waiting for a retry.
+ */
+int http_client_pending(void);
+
+/**
+ * @brief Copies the traffic counters.
+ */
+void http_client_get_stats(http_client_stats_t *stats);
+
+/**
+ * @brief Clears the traffic counters.
+ */
+void http_client_reset_stats(void);
+
+/**
+ * @brief Waits for network events and dispatches completions.
+ *
+ * Blocks for at most max_wait, or less if a request times out or a retry is
+ * due earlier. Expired requests are aborted, retries are started and
+ * completion callbacks are invoked from here.
+ *
+ * @param max_wait Upper bound on the time spent blocked, in ticks.
+ */
+void http_client_poll(TickType_t max_wait);
+
+#endif // HTTP_CLIENT_H
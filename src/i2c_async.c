@@ -0,0 +1,121 @@
+/**
+ * @file i2c_async.c
+ * @brief Implementation of interrupt-driven I2C transfers.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "i2c_async.h"
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct
+{
+    TaskHandle_t waiting; // task blocked on the transfer in progress
+    volatile bool aborted;
+} transfer_t;
+
+static transfer_t transfers[2];
+
+static void i2c_async_irq(i2c_inst_t *i2c, transfer_t *t)
+{
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    uint32_t status = hw->intr_stat;
+
+    if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+    {
+        (void)hw->clr_tx_abrt; // also releases the flushed TX FIFO
+        t->aborted = true;
+    }
+    if (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+        (void)hw->clr_stop_det;
+
+    // Done either way: an abort ends the transfer even if no STOP follows
+    hw->intr_mask = 0;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    if (t->waiting != NULL)
+        vTaskNotifyGiveFromISR(t->waiting, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+static void i2c0_irq(void)
+{
+    i2c_async_irq(i2c0, &transfers[0]);
+}
+
+static void i2c1_irq(void)
+{
+    i2c_async_irq(i2c1, &transfers[1]);
+}
+
+void i2c_async_init(i2c_inst_t *i2c)
+{
+    uint index = i2c_hw_index(i2c);
+    i2c_get_hw(i2c)->intr_mask = 0;
+    irq_set_exclusive_handler(index == 0 ? I2C0_IRQ : I2C1_IRQ, index == 0 ? i2c0_irq : i2c1_irq);
+    irq_set_enabled(index == 0 ? I2C0_IRQ : I2C1_IRQ, true);
+}
+
+// src for a write, dst for a read
+static int transfer(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, uint8_t *dst, size_t len, uint32_t timeout_ms)
+{
+    if (len == 0 || len > I2C_ASYNC_MAX_LEN)
+        return PICO_ERROR_GENERIC;
+
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    transfer_t *t = &transfers[i2c_hw_index(i2c)];
+
+    hw->enable = 0;
+    hw->tar = addr;
+    hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+    (void)hw->clr_intr; // leftovers of an earlier timed out transfer
+
+    t->waiting = xTaskGetCurrentTaskHandle();
+    t->aborted = false;
+    ulTaskNotifyTake(pdTRUE, 0); // a stale give would end the wait early
+
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t cmd = src != NULL ? src[i] : I2C_IC_DATA_CMD_CMD_BITS;
+        if (i == len - 1)
+            cmd |= I2C_IC_DATA_CMD_STOP_BITS;
+        hw->data_cmd = cmd;
+    }
+
+    // Unmasked after the FIFO is full: a STOP or abort that already happened
+    // stays latched and interrupts right away
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) == 0)
+    {
+        hw->intr_mask = 0;
+        hw->enable = I2C_IC_ENABLE_ENABLE_BITS | I2C_IC_ENABLE_ABORT_BITS; // bus stuck: let the controller give up
+        t->waiting = NULL;
+        return PICO_ERROR_TIMEOUT;
+    }
+    t->waiting = NULL;
+
+    if (t->aborted)
+        return PICO_ERROR_GENERIC;
+
+    if (dst != NULL)
+    {
+        for (size_t i = 0; i < len; i++)
+            dst[i] = (uint8_t)hw->data_cmd;
+    }
+    return (int)len;
+}
+
+int i2c_async_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, uint32_t timeout_ms)
+{
+    return transfer(i2c, addr, src, NULL, len, timeout_ms);
+}
+
+int i2c_async_read(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, uint32_t timeout_ms)
+{
+    return transfer(i2c, addr, NULL, dst, len, timeout_ms);
+}
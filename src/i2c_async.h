@@ -0,0 +1,45 @@
+/**
+ * @file i2c_async.h
+ * @brief Definitions for interrupt-driven I2C transfers.
+ *
+ * A transfer is queued whole into the controller's 16-entry TX FIFO (data
+ * bytes for a write, read commands for a read, STOP on the last one), then
+ * the calling task blocks on a notification. The I2C interrupt fires once,
+ * on STOP or abort, and wakes it; read data is waiting in the RX FIFO. The
+ * CPU never spins on the bus, so the task can run at a low priority without
+ * its transfers being stretched by the tasks above it.
+ *
+ * One transfer at a time per controller; only tasks may call these.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef I2C_ASYNC_H
+#define I2C_ASYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hardware/i2c.h"
+
+#define I2C_ASYNC_MAX_LEN 16 // FIFO depth: longer transfers would need refilling from the interrupt
+
+/**
+ * @brief Installs the interrupt handler. Call after i2c_init().
+ */
+void i2c_async_init(i2c_inst_t *i2c);
+
+/**
+ * @brief Writes len bytes, ending with STOP.
+ * @return len, PICO_ERROR_GENERIC if the address or a byte was not acknowledged
+ * (or len is out of range), PICO_ERROR_TIMEOUT.
+ */
+int i2c_async_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, uint32_t timeout_ms);
+
+/**
+ * @brief Reads len bytes, ending with STOP. Same return values as i2c_async_write().
+ */
+int i2c_async_read(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, uint32_t timeout_ms);
+
+#endif // I2C_ASYNC_H
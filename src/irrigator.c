@@ -11,72 +11,394 @@
 
 #include "irrigator.h"   // For function prototype and pin definitions
 #include "pico/stdlib.h" // For gpio_... functions
+#include "hardware/sync.h" // For save_and_disable_interrupts
 #include "FreeRTOS.h"    // For FreeRTOS types
 #include "task.h"        // For vTaskDelay, TaskHandle_t, etc.
+#include "timers.h"      // For the wake up timer
 #include "buzzer.h"      // For buzzer feedback
 #include <stdio.h>       // For printf
 #include <limits.h>      // For ULONG_MAX
+#include <string.h>      // For memcpy
 #include "oled.h"        // For oled_task_handle
 #include "clock.h"
+#include "journal.h"
+#include "seqlock.h"
+#include "flow.h"
+#include "pico/time.h"   // For to_ms_since_boot, time_us_64
 
-static uint8_t irrigator_on = 0;
-static schedule_item_t schedule[IRRIGATOR_MAX_SCHEDULE_SIZE];
-static int remote_duration = 0;
+static const uint8_t zone_pins[IRRIGATOR_ZONE_COUNT] = IRRIGATOR_ZONE_PINS;
+static volatile uint32_t open_zones = 0; // bit n = zone n open, read by other tasks
+static controller_t controller;           // only touched by the irrigator task
+static controller_result_t step_result;   // too big for the 256-word task stack (events[]), so one shared by the task
+
+// Flow sensor pulses attributed to each zone since boot
+static uint64_t zone_pulses[IRRIGATOR_ZONE_COUNT];
+static uint64_t started_pulses[IRRIGATOR_ZONE_COUNT]; // zone_pulses[] when the run started
+static uint64_t flow_accounted = 0;
+static alarm_id_t stop_alarm = 0;         // hardware alarm of the next run end, 0 if none
+static volatile uint32_t stop_alarm_zones = 0;
+static schedule_store_t stores[2];      // the published store and the one the next version is prepared in
+static const schedule_store_t *volatile store = &stores[0]; // published, read under store_lock
+static seqlock_t store_lock = SEQLOCK_INIT;
+static volatile bool store_preparing = false; // a writer is filling the unpublished store
+static volatile bool store_stale = false;     // and the published one changed meanwhile
+
+// Command ring: many producers (ISRs, lwIP callbacks, tasks), one consumer (the task)
+static irrigator_command_t commands[IRRIGATOR_COMMAND_QUEUE_SIZE];
+static volatile uint32_t command_head = 0; // next to read, only advanced by the task
+static volatile uint32_t command_tail = 0; // next to write
+static irrigator_command_stats_t command_stats;
 TaskHandle_t irrigator_task_handle = NULL;
 
-void irrigator_set_schedule(int index, uint8_t hour, uint8_t minute, uint8_t duration, uint8_t active)
+// Safe from any context. The new version is prepared in the unpublished
+// store with interrupts enabled (a 10 KB copy plus the O(n) index update),
+// and interrupts are only masked to swap the pointer. A writer that
+// interrupts another one mid-preparation updates the published store in
+// place under the seqlock instead, and the interrupted one starts over.
+static bool store_schedule(int index, const schedule_item_t *item)
 {
-    if (index >= 0 && index < IRRIGATOR_MAX_SCHEDULE_SIZE)
+    if (index < 0 || index >= IRRIGATOR_MAX_SCHEDULE_SIZE || item->zone >= IRRIGATOR_ZONE_COUNT)
+        return false;
+
+    for (;;)
     {
-        schedule[index].hour = hour;
-        schedule[index].minute = minute;
-        schedule[index].duration = duration;
-        schedule[index].active = active;
+        uint32_t saved = save_and_disable_interrupts();
+        bool nested = store_preparing;
+        store_preparing = true;
+        if (!nested)
+            store_stale = false;
+        restore_interrupts(saved);
+
+        schedule_store_t *published = store == &stores[0] ? &stores[0] : &stores[1];
+        if (nested)
+        {
+            saved = seqlock_write_begin(&store_lock);
+            schedule_store_set(published, index, item);
+            store_stale = true;
+            seqlock_write_end(&store_lock, saved);
+            return true;
+        }
+
+        schedule_store_t *next = published == &stores[0] ? &stores[1] : &stores[0];
+        memcpy(next, published, sizeof(*next));
+        schedule_store_set(next, index, item);
+
+        saved = seqlock_write_begin(&store_lock);
+        bool ok = !store_stale;
+        if (ok)
+            store = next;
+        store_preparing = false;
+        seqlock_write_end(&store_lock, saved);
+        if (ok)
+            return true;
     }
 }
 
-void irrigator_set_remote_duration(int duration)
+bool irrigator_set_schedule(int index, const schedule_item_t *item)
+{
+    bool ok = store_schedule(index, item);
+    if (ok)
+        irrigator_reschedule();
+    return ok;
+}
+
+bool irrigator_set_schedule_from_isr(int index, const schedule_item_t *item, BaseType_t *higher_priority_task_woken)
 {
-    remote_duration = duration;
+    bool ok = store_schedule(index, item);
+    if (ok)
+        irrigator_reschedule_from_isr(higher_priority_task_woken);
+    return ok;
 }
 
-void irrigator_get_all_schedules(schedule_item_t *items)
+// Caller holds the critical section
+static bool command_push(uint8_t command, uint8_t source, int zone, int duration)
 {
+    command_stats.received++;
+    if (!irrigator_zone_valid(zone))
+        return false;
+    if (command_tail - command_head >= IRRIGATOR_COMMAND_QUEUE_SIZE)
+    {
+        command_stats.dropped++;
+        return false;
+    }
+
+    irrigator_command_t *c = &commands[command_tail % IRRIGATOR_COMMAND_QUEUE_SIZE];
+    c->command = command;
+    c->source = source;
+    c->zone = (int8_t)zone;
+    c->duration = (uint16_t)irrigator_clamp_duration(duration);
+    c->queued_us = time_us_64();
+    command_tail++;
+    return true;
+}
+
+static bool command_pop(irrigator_command_t *out)
+{
+    bool ok = false;
+
+    taskENTER_CRITICAL();
+    if (command_head != command_tail)
+    {
+        *out = commands[command_head % IRRIGATOR_COMMAND_QUEUE_SIZE];
+        command_head++;
+        ok = true;
+    }
+    taskEXIT_CRITICAL();
+    return ok;
+}
+
+bool irrigator_send_command(uint8_t command, uint8_t source, int zone, int duration)
+{
+    taskENTER_CRITICAL();
+    bool ok = command_push(command, source, zone, duration);
+    taskEXIT_CRITICAL();
+
+    if (irrigator_task_handle != NULL)
+        xTaskNotify(irrigator_task_handle, 0, eNoAction);
+    return ok;
+}
+
+bool irrigator_send_command_from_isr(uint8_t command, uint8_t source, int zone, int duration, BaseType_t *higher_priority_task_woken)
+{
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    bool ok = command_push(command, source, zone, duration);
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+
+    if (irrigator_task_handle != NULL)
+        xTaskNotifyFromISR(irrigator_task_handle, 0, eNoAction, higher_priority_task_woken);
+    return ok;
+}
+
+// Read from lwIP callbacks (GET /status); the FROM_ISR pair only masks
+// interrupts, so it is valid from a task too
+void irrigator_get_command_stats(irrigator_command_stats_t *stats)
+{
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    *stats = command_stats;
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+int irrigator_clamp_duration(int seconds)
+{
+    if (seconds < 0)
+        return 0;
+    return seconds > IRRIGATOR_MAX_DURATION_S ? IRRIGATOR_MAX_DURATION_S : seconds;
+}
+
+bool irrigator_zone_valid(int zone)
+{
+    return zone >= -1 && zone < IRRIGATOR_ZONE_COUNT;
+}
+
+bool irrigator_get_schedule(int index, schedule_item_t *item)
+{
+    if (index < 0 || index >= IRRIGATOR_MAX_SCHEDULE_SIZE)
+        return false;
+
+    // The pointer is read inside the loop: the store behind it may be reused once swapped
+    uint32_t seq;
+    do
+    {
+        seq = seqlock_read_begin(&store_lock);
+        *item = store->entries[index];
+    } while (seqlock_read_retry(&store_lock, seq));
+    return true;
+}
+
+int irrigator_schedules_to_json(char *buffer, size_t size)
+{
+    int offset = snprintf(buffer, size, "[");
+    bool first = true;
+
     for (int i = 0; i < IRRIGATOR_MAX_SCHEDULE_SIZE; i++)
     {
-        items[i] = schedule[i];
+        schedule_item_t item;
+        irrigator_get_schedule(i, &item);
+        if (item.days == 0)
+            continue; // unused slot
+
+        char entry[160];
+        int len = snprintf(entry, sizeof(entry),
+            "%s{\"index\":%d,\"hour\":%d,\"minute\":%d,\"duration\":%d,\"active\":%d,\"zone\":%d,\"days\":%d,\"seasonStart\":%d,\"seasonEnd\":%d}",
+            first ? "" : ",", i, item.hour, item.minute, item.duration, item.active, item.zone, item.days, item.season_start, item.season_end);
+
+        // Whole entries only, leaving room for the closing bracket
+        if (offset + len + 2 > (int)size)
+            break;
+        memcpy(buffer + offset, entry, len);
+        offset += len;
+        first = false;
     }
+
+    offset += snprintf(buffer + offset, size - offset, "]");
+    return offset;
 }
 
 void irrigator_init(void)
 {
-    gpio_init(IRRIGATOR_PIN);
-    gpio_set_dir(IRRIGATOR_PIN, GPIO_OUT);
-    gpio_put(IRRIGATOR_PIN, 0); // irrigator starts turned off
+    for (int i = 0; i < IRRIGATOR_ZONE_COUNT; i++)
+    {
+        gpio_init(zone_pins[i]);
+        gpio_set_dir(zone_pins[i], GPIO_OUT);
+        gpio_put(zone_pins[i], 0); // valves start closed
+    }
+    controller_init(&controller, &store, &store_lock, IRRIGATOR_ZONE_COUNT, IRRIGATOR_PUMP_CAPACITY);
+    controller.missed_policy = IRRIGATOR_MISSED_POLICY;
+    controller.catchup_window_min = IRRIGATOR_CATCHUP_WINDOW_MIN;
+    flow_init();
 
     // default schedule for temporary tests
-    // irrigator_set_schedule(0, 13, 12, 60 * 2, 1);
+    // irrigator_set_schedule(0, &(schedule_item_t){ .hour = 13, .minute = 12, .duration = 120, .active = 1, .days = SCHEDULE_EVERY_DAY });
+}
+
+static uint32_t now_ms(void)
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Hardware timer IRQ: closes the valves of the runs ending now, with
+// millisecond precision, then lets the task update the zone model
+static int64_t stop_alarm_callback(alarm_id_t id, void *user_data)
+{
+    uint32_t mask = stop_alarm_zones;
+    for (int i = 0; i < IRRIGATOR_ZONE_COUNT; i++)
+    {
+        if (mask & (1u << i))
+            gpio_put(zone_pins[i], 0);
+    }
+    open_zones &= ~mask;
+    stop_alarm = 0;
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    xTaskNotifyFromISR(irrigator_task_handle, 0, eNoAction, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    return 0; // one shot
+}
+
+// Attributes the pulses counted since the last call to the zones that were
+// open meanwhile. The sensor is on the shared pump line, so pulses are split
+// evenly when several zones were open (exact with IRRIGATOR_PUMP_CAPACITY 1).
+static void account_flow(uint32_t open_mask)
+{
+    uint64_t count = flow_get_count();
+    uint64_t delta = count - flow_accounted;
+    flow_accounted = count;
+
+    int open = 0;
+    for (int i = 0; i < IRRIGATOR_ZONE_COUNT; i++)
+    {
+        if (open_mask & (1u << i))
+            open++;
+    }
+    if (open == 0)
+        return; // leak or drain with every valve closed, not billed to a zone
+
+    uint64_t remainder = delta % open;
+    for (int i = 0; i < IRRIGATOR_ZONE_COUNT; i++)
+    {
+        if (open_mask & (1u << i))
+        {
+            zone_pulses[i] += delta / open + remainder;
+            remainder = 0;
+        }
+    }
+}
+
+// Records the runs that started or ended in a controller step
+static void journal_runs(uint32_t before, uint32_t after, uint32_t now)
+{
+    account_flow(before);
+
+    datetime_t t;
+    if (!clock_get_time(&t))
+        memset(&t, 0, sizeof(t));
+    uint32_t time = journal_time(&t);
+
+    for (int i = 0; i < IRRIGATOR_ZONE_COUNT; i++)
+    {
+        uint32_t bit = 1u << i;
+        if (!((before ^ after) & bit))
+            continue;
+
+        const controller_run_t *run = &controller.runs[i];
+        journal_event_t event = {
+            .time = time,
+            .zone = (uint8_t)i,
+            .source = run->source,
+            .planned_s = run->planned_s,
+        };
+        if (after & bit)
+        {
+            started_pulses[i] = zone_pulses[i];
+            event.type = JOURNAL_START;
+        }
+        else
+        {
+            uint32_t volume = flow_pulses_to_dl(zone_pulses[i] - started_pulses[i]);
+            event.type = JOURNAL_STOP;
+            event.actual_s = (uint16_t)((now - run->started_ms + 500) / 1000);
+            event.volume_dl = volume > UINT16_MAX ? UINT16_MAX : (uint16_t)volume;
+        }
+        journal_append(&event);
+    }
+}
+
+// Runs a controller step, drives the valves from its result and arms the
+// alarm of the next run end. t is NULL when only commands changed the model.
+static void apply_zones(const datetime_t *t, controller_result_t *result)
+{
+    if (stop_alarm > 0)
+    {
+        cancel_alarm(stop_alarm);
+        stop_alarm = 0;
+    }
+
+    uint32_t now = now_ms();
+    controller_step(&controller, t, now, result);
+    uint32_t mask = result->open_mask;
+
+    // open_zones may already lack the valves the alarm closed
+    for (int i = 0; i < IRRIGATOR_ZONE_COUNT; i++)
+    {
+        if ((mask ^ open_zones) & (1u << i))
+            gpio_put(zone_pins[i], (mask >> i) & 1);
+    }
+    open_zones = mask;
+
+    if (result->opened | result->closed)
+    {
+        journal_runs((mask & ~result->opened) | result->closed, mask, now);
+        if (oled_task_handle != NULL)
+            xTaskNotifyGive(oled_task_handle);
+    }
+
+    if (result->next_stop_ms != ZONES_NO_DEADLINE)
+    {
+        stop_alarm_zones = result->ending_mask;
+        stop_alarm = add_alarm_in_ms(result->next_stop_ms, stop_alarm_callback, NULL, false);
+        if (stop_alarm <= 0)
+        {
+            stop_alarm = 0;
+            irrigator_reschedule(); // already due (or no alarm slot): next pass closes it
+        }
+    }
 }
 
 void irrigator_turn_on(void)
 {
-    gpio_put(IRRIGATOR_PIN, 1);
-    irrigator_on = 1;
-    if (oled_task_handle != NULL)
-        xTaskNotifyGive(oled_task_handle);
+    controller_request(&controller, 0, 0, IRRIGATOR_SOURCE_BUTTON, now_ms()); // until turned off
+    apply_zones(NULL, &step_result);
 }
 
 void irrigator_turn_off(void)
 {
-    gpio_put(IRRIGATOR_PIN, 0);
-    irrigator_on = 0;
-    if (oled_task_handle != NULL)
-        xTaskNotifyGive(oled_task_handle);
+    controller_stop(&controller, -1);
+    apply_zones(NULL, &step_result);
 }
 
 void irrigator_toggle(void)
 {
-    if (irrigator_on)
+    if (irrigator_is_on())
     {
         irrigator_turn_off();
     }
@@ -88,119 +410,199 @@ void irrigator_toggle(void)
 
 int irrigator_is_on(void)
 {
-    return irrigator_on;
+    return open_zones != 0;
 }
 
-void irrigator_task(void *pvParameters)
+uint32_t irrigator_open_zones(void)
 {
-    irrigator_init();
-    uint32_t notification_value;
-    int remaining_duration = 0;
-    datetime_t t;
-    uint8_t last_sec = 60;
+    return open_zones;
+}
 
-    while (1)
+uint32_t irrigator_zone_volume_dl(int zone)
+{
+    if (zone < 0 || zone >= IRRIGATOR_ZONE_COUNT)
+        return 0;
+    return flow_pulses_to_dl(zone_pulses[zone]);
+}
+
+// Logs what the schedule did in a step; skipped starts also go to the journal
+static void report_schedule(const controller_result_t *result)
+{
+    if (result->clock_jump_s != 0)
+        printf("Relógio saltou %ld s.\n", (long)result->clock_jump_s);
+    if (result->dropped_min > 0)
+        printf("Agendamentos de %lu min antes da janela de recuperação ignorados.\n", (unsigned long)result->dropped_min);
+
+    for (int i = 0; i < result->event_count; i++)
+    {
+        const controller_event_t *e = &result->events[i];
+        char time[20];
+        journal_format_time(e->minute * 60, time, sizeof(time));
+
+        switch (e->action)
+        {
+        case CONTROLLER_STARTED:
+            printf("Irrigação iniciada por agendamento: zona %d, %s por %d s.\n", e->zone, time + 11, e->duration_s);
+            break;
+        case CONTROLLER_STARTED_LATE:
+            printf("Agendamento de %s perdido, iniciado com %lu s de atraso: zona %d por %d s.\n", time, (unsigned long)e->late_s, e->zone, e->duration_s);
+            break;
+        case CONTROLLER_SHORTENED:
+            printf("Agendamento de %s perdido, encurtado: zona %d por %d s.\n", time, e->zone, e->duration_s);
+            break;
+        default:
+            printf("Agendamento de %s perdido e ignorado: zona %d.\n", time, e->zone);
+            journal_append(&(journal_event_t){
+                .time = e->minute * 60,
+                .type = JOURNAL_SKIP,
+                .zone = e->zone,
+                .source = IRRIGATOR_SOURCE_SCHEDULE,
+                .planned_s = e->duration_s,
+            });
+            break;
+        }
+    }
+    if (result->events_lost > 0)
+        printf("%d agendamentos recuperados não listados.\n", result->events_lost);
+    if (result->starts_dropped > 0)
+        printf("%d agendamentos no mesmo minuto além de %d ignorados.\n", result->starts_dropped, ZONES_MAX);
+}
+
+static void wake_timer_callback(TimerHandle_t timer)
+{
+    xTaskNotify(irrigator_task_handle, 0, eNoAction);
+}
+
+void irrigator_reschedule(void)
+{
+    // eNoAction wakes the task without overwriting a pending command
+    if (irrigator_task_handle != NULL)
+        xTaskNotify(irrigator_task_handle, 0, eNoAction);
+}
+
+void irrigator_reschedule_from_isr(BaseType_t *higher_priority_task_woken)
+{
+    if (irrigator_task_handle != NULL)
+        xTaskNotifyFromISR(irrigator_task_handle, 0, eNoAction, higher_priority_task_woken);
+}
+
+static void handle_command(const irrigator_command_t *command)
+{
+    bool button = command->source == IRRIGATOR_SOURCE_BUTTON;
+
+    uint32_t latency = (uint32_t)(time_us_64() - command->queued_us);
+    taskENTER_CRITICAL();
+    command_stats.last_latency_us = latency;
+    if (latency > command_stats.max_latency_us)
+        command_stats.max_latency_us = latency;
+    taskEXIT_CRITICAL();
+
+    // Handle turning ON
+    if (command->command == IRRIGATOR_TURN_ON && button)
+    {
+        if (!(open_zones & 1))
+        {
+            irrigator_turn_on(); // Manual activation, first zone
+            buzzer_song_of_storms(); // Buzzer only for button
+            printf("Irrigação ativada!\n");
+        }
+        else
+        {
+            printf("A irrigaçao já está ativada!\n");
+        }
+    }
+    else if (command->command == IRRIGATOR_TURN_ON)
     {
-        // Wait for notification from ISR (Button) or other tasks
-        if (xTaskNotifyWait(0, ULONG_MAX, &notification_value, pdMS_TO_TICKS(100)) == pdTRUE)
+        // Queued behind other zones if the pump is at capacity
+        if (controller_request(&controller, command->zone, command->duration, command->source, now_ms()))
+            printf("Irrigação ativada remotamente! Zona %d, duração: %d s\n", command->zone, command->duration);
+        else
+            printf("Zona %d inexistente!\n", command->zone);
+    }
+    // Handle turning OFF
+    else if (command->command == IRRIGATOR_TURN_OFF)
+    {
+        if (command->zone >= 0)
         {
-            // Handle turning ON
-            if (notification_value == IRRIGATOR_TURN_ON || notification_value == IRRIGATOR_REMOTE_TURN_ON)
+            controller_stop(&controller, command->zone);
+            apply_zones(NULL, &step_result);
+            printf("Zona %d desativada remotamente!\n", command->zone);
+        }
+        else if (irrigator_is_on())
+        {
+            irrigator_turn_off();
+            if (button)
+            { // Buzzer only for button
+                buzzer_play_note(NOTE_C4, 200);
+                printf("Irrigação desativada!\n");
+            }
+            else
             {
-                if (!irrigator_is_on())
-                {
-                    irrigator_turn_on();
-                    
-                    if (notification_value == IRRIGATOR_REMOTE_TURN_ON) {
-                        remaining_duration = remote_duration;
-                        remote_duration = 0; // Reset
-                    } else {
-                        remaining_duration = 0; // Manual activation
-                    }
-
-                    if (notification_value == IRRIGATOR_TURN_ON)
-                    { // Buzzer only for button
-                        buzzer_song_of_storms();
-                        printf("Irrigação ativada!\n");
-                    }
-                    else
-                    {
-                        printf("Irrigação ativada remotamente! Duração: %d s\n", remaining_duration);
-                    }
-                }
-                else
-                {
-                    if (notification_value == IRRIGATOR_TURN_ON)
-                    {
-                        printf("A irrigaçao já está ativada!\n");
-                    }
-                }
+                printf("Irrigação desativada remotamente!\n");
             }
-            // Handle turning OFF
-            else if (notification_value == IRRIGATOR_TURN_OFF || notification_value == IRRIGATOR_REMOTE_TURN_OFF)
+        }
+        else
+        {
+            controller_stop(&controller, -1); // drops queued runs too
+            if (button)
             {
-                if (irrigator_is_on())
-                {
-                    irrigator_turn_off();
-                    remaining_duration = 0;
-                    if (notification_value == IRRIGATOR_TURN_OFF)
-                    { // Buzzer only for button
-                        buzzer_play_note(NOTE_C4, 200);
-                        printf("Irrigação desativada!\n");
-                    }
-                    else
-                    {
-                        printf("Irrigação desativada remotamente!\n");
-                    }
-                }
-                else
-                {
-                    if (notification_value == IRRIGATOR_TURN_OFF)
-                    {
-                        buzzer_play_note(NOTE_C5, 200);
-                        printf("A irrigaçao já está desativada!\n");
-                    }
-                }
+                buzzer_play_note(NOTE_C5, 200);
+                printf("A irrigaçao já está desativada!\n");
             }
         }
+    }
+}
+
+void irrigator_task(void *pvParameters)
+{
+    irrigator_init();
+    datetime_t t;
+    controller_result_t *result = &step_result;
+    UBaseType_t stack_low = ~(UBaseType_t)0; // the first pass logs
+
+    TimerHandle_t wake_timer = xTimerCreate("Irrigator_Wake", 1, pdFALSE, NULL, wake_timer_callback);
+    xTimerStart(wake_timer, portMAX_DELAY); // first pass computes the initial wake up
 
-        // Check schedule
-        if (clock_get_time(&t))
+    while (1)
+    {
+        // Sleeps until a command arrives, the schedule or the clock changes,
+        // the start timer fires or the stop alarm has closed a valve
+        xTaskNotifyWait(0, ULONG_MAX, NULL, portMAX_DELAY);
+
+        // Commands, oldest first
+        irrigator_command_t command;
+        while (command_pop(&command))
+            handle_command(&command);
+
+        // Start triggers (with the ones a clock jump skipped), run ends and the
+        // next wake up; schedules wait for the clock
+        apply_zones(clock_get_time(&t) ? &t : NULL, result);
+
+        report_schedule(result);
+        if (result->closed)
+            printf("Irrigação finalizada pelo agendamento.\n");
+
+        TickType_t sleep = pdMS_TO_TICKS(IRRIGATOR_MAX_SLEEP_MS);
+        if (result->next_start_s >= 0 && pdMS_TO_TICKS(result->next_start_s * 1000) < sleep)
+            sleep = pdMS_TO_TICKS(result->next_start_s * 1000);
+
+        // next_start_s counts local minutes: recompute it when DST changes the offset
+        int64_t offset_change = clock_seconds_to_offset_change();
+        if (offset_change >= 0 && offset_change * 1000 < IRRIGATOR_MAX_SLEEP_MS && pdMS_TO_TICKS(offset_change * 1000) < sleep)
+            sleep = pdMS_TO_TICKS(offset_change * 1000);
+
+        // Period 0 is not allowed; a start due now fires on the next wake
+        xTimerChangePeriod(wake_timer, sleep > 0 ? sleep : 1, portMAX_DELAY);
+
+        // Stack overflow checking is off: log each new low of the free stack
+        if (IRRIGATOR_LOG_STACK_USAGE)
         {
-            if (t.sec != last_sec)
+            UBaseType_t stack_free = uxTaskGetStackHighWaterMark(NULL);
+            if (stack_free < stack_low)
             {
-                last_sec = t.sec;
-
-                // Handle duration
-                if (irrigator_is_on() && remaining_duration > 0)
-                {
-                    remaining_duration--;
-                    if (remaining_duration == 0)
-                    {
-                        irrigator_turn_off();
-                        // buzzer_play_note(NOTE_C4, 200); // Buzzer removido conforme solicitado
-                        printf("Irrigação finalizada pelo agendamento.\n");
-                    }
-                }
-
-                // Check start triggers
-                if (t.sec == 0)
-                {
-                    for (int i = 0; i < IRRIGATOR_MAX_SCHEDULE_SIZE; i++)
-                    {
-                        if (schedule[i].active && schedule[i].hour == t.hour && schedule[i].minute == t.min)
-                        {
-                            if (!irrigator_is_on())
-                            {
-                                irrigator_turn_on();
-                                remaining_duration = schedule[i].duration;
-                                // buzzer_song_of_storms(); // Buzzer removido conforme solicitado
-                                printf("Irrigação iniciada por agendamento: %02d:%02d por %d s.\n", t.hour, t.min, remaining_duration);
-                            }
-                        }
-                    }
-                }
+                stack_low = stack_free;
+                printf("Irrigator: pilha livre mínima %u palavras.\n", (unsigned)stack_low);
             }
         }
     }
-}
\ No newline at end of file
+}
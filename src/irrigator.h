@@ -15,27 +15,63 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "schedule.h"
+#include "zones.h"
+#include "controller.h"
+#include <stddef.h>
 
 // Irrigator pin acording the board adaptations described on this project documentation
 #define IRRIGATOR_PIN 17
 
-// Task notification values
+// One valve relay per zone; zone 0 is the board's relay. Add a GPIO per extra zone, e.g. { IRRIGATOR_PIN, 16, 18 }
+#define IRRIGATOR_ZONE_PINS { IRRIGATOR_PIN }
+#define IRRIGATOR_ZONE_COUNT 1      // entries in IRRIGATOR_ZONE_PINS, at most ZONES_MAX
+#define IRRIGATOR_PUMP_CAPACITY 1   // valves the pump can feed at once; extra runs wait their turn
+
+// Commands
 #define IRRIGATOR_TURN_ON 1
 #define IRRIGATOR_TURN_OFF 2
-#define IRRIGATOR_REMOTE_TURN_ON 3
-#define IRRIGATOR_REMOTE_TURN_OFF 4
 
-#define IRRIGATOR_MAX_SCHEDULE_SIZE 4
+// Command sources
+#define IRRIGATOR_SOURCE_BUTTON 0
+#define IRRIGATOR_SOURCE_LOCAL_API 1
+#define IRRIGATOR_SOURCE_GLOBAL_API 2
+#define IRRIGATOR_SOURCE_SCHEDULE CONTROLLER_SOURCE_SCHEDULE
+
+#define IRRIGATOR_COMMAND_QUEUE_SIZE 16 // commands waiting for the task; bursts beyond this are counted as dropped
+
+// Logs each new low of the task's free stack (words), to size its stack
+#define IRRIGATOR_LOG_STACK_USAGE false
+
+#define IRRIGATOR_MAX_SCHEDULE_SIZE SCHEDULE_MAX_ENTRIES
+#define IRRIGATOR_MAX_DURATION_S (4 * 3600) // longest run accepted from the APIs
 
-struct schedule_item
+// The task sleeps until the next schedule start or stop; this only bounds
+// how long a missed reschedule could go unnoticed
+#define IRRIGATOR_MAX_SLEEP_MS (6 * 3600 * 1000)
+
+// Schedule starts the clock jumped over (NTP or POST /clock setting it forward):
+// CONTROLLER_MISSED_RUN_LATE, CONTROLLER_MISSED_SHORTEN or CONTROLLER_MISSED_SKIP.
+// Starts older than the window are skipped whatever the policy.
+#define IRRIGATOR_MISSED_POLICY CONTROLLER_MISSED_RUN_LATE
+#define IRRIGATOR_CATCHUP_WINDOW_MIN 120
+
+typedef struct
 {
-    uint8_t hour;
-    uint8_t minute;
-    uint8_t duration; // in seconds
-    uint8_t active;
-};
+    uint8_t command;    // IRRIGATOR_TURN_ON / IRRIGATOR_TURN_OFF
+    uint8_t source;     // IRRIGATOR_SOURCE_...
+    int8_t zone;        // -1 = every zone (turn off only)
+    uint16_t duration;  // seconds, 0 = until turned off
+    uint64_t queued_us; // time_us_64() when queued
+} irrigator_command_t;
 
-typedef struct schedule_item schedule_item_t;
+typedef struct
+{
+    uint32_t received;
+    uint32_t dropped;        // queue full
+    uint32_t last_latency_us; // from queued to handled by the task
+    uint32_t max_latency_us;
+} irrigator_command_stats_t;
 
 /**
  * @brief Handle for irrigator task.
@@ -47,10 +83,62 @@ void irrigator_init(void);
 void irrigator_turn_on(void);
 void irrigator_turn_off(void);
 void irrigator_toggle(void);
-int irrigator_is_on(void);
-void irrigator_set_schedule(int index, uint8_t hour, uint8_t minute, uint8_t duration, uint8_t active);
-void irrigator_set_remote_duration(int duration);
-void irrigator_get_all_schedules(schedule_item_t *items);
+int irrigator_is_on(void); // any zone open
+
+/**
+ * @brief Bit n set when zone n is open.
+ */
+uint32_t irrigator_open_zones(void);
+
+/**
+ * @brief Water delivered to a zone since boot, in decilitres, as of its last opening or closing.
+ */
+uint32_t irrigator_zone_volume_dl(int zone);
+
+/**
+ * @brief Stores a schedule entry and makes the task pick it up.
+ * Use the _from_isr variant in interrupts and lwIP callbacks.
+ */
+bool irrigator_set_schedule(int index, const schedule_item_t *item);
+bool irrigator_set_schedule_from_isr(int index, const schedule_item_t *item, BaseType_t *higher_priority_task_woken);
+
+/**
+ * @brief Queues a command for the irrigator task, in order and without
+ * overwriting earlier ones. Use the _from_isr variant in interrupts and lwIP callbacks.
+ * @param zone Zone, or -1 for every zone (turn off only).
+ * @param duration Seconds, 0 = until turned off.
+ * @return false if the queue is full (the command is dropped and counted) or
+ * the zone is not valid for irrigator_zone_valid().
+ */
+bool irrigator_send_command(uint8_t command, uint8_t source, int zone, int duration);
+bool irrigator_send_command_from_isr(uint8_t command, uint8_t source, int zone, int duration, BaseType_t *higher_priority_task_woken);
+
+void irrigator_get_command_stats(irrigator_command_stats_t *stats);
+
+/**
+ * @brief Limits a run length in seconds to 0..IRRIGATOR_MAX_DURATION_S.
+ */
+int irrigator_clamp_duration(int seconds);
+
+/**
+ * @brief Zone accepted by the commands: 0..IRRIGATOR_ZONE_COUNT-1, or -1 for every zone.
+ */
+bool irrigator_zone_valid(int zone);
+bool irrigator_get_schedule(int index, schedule_item_t *item);
+
+/**
+ * @brief Writes the slots in use as a JSON array (whole entries only, truncated to fit).
+ * @return Length written.
+ */
+int irrigator_schedules_to_json(char *buffer, size_t size);
+
+/**
+ * @brief Makes the task recompute its next wake up.
+ * Call after setting the clock; schedule changes already do it.
+ * Use the _from_isr variant in interrupts and lwIP callbacks.
+ */
+void irrigator_reschedule(void);
+void irrigator_reschedule_from_isr(BaseType_t *higher_priority_task_woken);
 void irrigator_task(void *pvParameters);
 
 #endif // IRRIGATOR_H
\ No newline at end of file
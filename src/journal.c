@@ -0,0 +1,68 @@
+/**
+ * @file journal.c
+ * @brief Implementation of the irrigation event journal.
+ *
+ * Reads come from lwIP callbacks (interrupt context), so every access masks
+ * interrupts through the _FROM_ISR critical section, which is also valid
+ * from a task.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "journal.h"
+#include "schedule.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+
+static journal_event_t events[JOURNAL_SIZE];
+static uint32_t next_seq = 0;
+
+uint32_t journal_time(const datetime_t *t)
+{
+    int32_t days = schedule_days_from_date(t->year, t->month, t->day);
+    if (days < 0)
+        return 0;
+    return (uint32_t)days * 86400u + t->hour * 3600u + t->min * 60u + t->sec;
+}
+
+void journal_format_time(uint32_t time, char *buffer, size_t size)
+{
+    int year, month, day;
+    uint32_t secs = time % 86400u;
+    schedule_date_from_days((int32_t)(time / 86400u), &year, &month, &day);
+    snprintf(buffer, size, "%04d-%02d-%02dT%02d:%02d:%02d",
+        year, month, day, (int)(secs / 3600), (int)(secs / 60 % 60), (int)(secs % 60));
+}
+
+void journal_append(const journal_event_t *event)
+{
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    events[next_seq % JOURNAL_SIZE] = *event;
+    next_seq++;
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+void journal_range(uint32_t *first, uint32_t *next)
+{
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    *next = next_seq;
+    *first = next_seq > JOURNAL_SIZE ? next_seq - JOURNAL_SIZE : 0;
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+bool journal_read(uint32_t seq, journal_event_t *event)
+{
+    bool ok = false;
+
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    if (seq < next_seq && next_seq - seq <= JOURNAL_SIZE)
+    {
+        *event = events[seq % JOURNAL_SIZE];
+        ok = true;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+    return ok;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file journal.h
+ * @brief Definitions for the irrigation event journal.
+ *
+ * A fixed RAM ring of compact start/stop records. When it is full the oldest
+ * record is overwritten. Records are addressed by a sequence number that keeps
+ * growing, so a reader paging through the history can tell when records it
+ * has not read yet were overwritten.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "pico/util/datetime.h"
+
+#define JOURNAL_SIZE 256 // records kept (16 bytes each)
+
+#define JOURNAL_START 1
+#define JOURNAL_STOP 2
+#define JOURNAL_SKIP 3 // scheduled start not run (clock jumped over it)
+
+typedef struct
+{
+    uint32_t time;      // local time, seconds since 2000-01-01 (see journal_time())
+    uint8_t type;       // JOURNAL_START / JOURNAL_STOP / JOURNAL_SKIP
+    uint8_t zone;
+    uint8_t source;     // IRRIGATOR_SOURCE_... that requested the run
+    uint8_t reserved;
+    uint16_t planned_s; // 0 = until turned off
+    uint16_t actual_s;  // JOURNAL_STOP only
+    uint16_t volume_dl; // JOURNAL_STOP only, decilitres from the flow sensor
+} journal_event_t;
+
+/**
+ * @brief Converts a local date to the journal time base.
+ */
+uint32_t journal_time(const datetime_t *t);
+
+/**
+ * @brief Formats a journal time as "YYYY-MM-DDTHH:MM:SS".
+ */
+void journal_format_time(uint32_t time, char *buffer, size_t size);
+
+/**
+ * @brief Appends a record, overwriting the oldest one when full.
+ * Only the irrigator task writes.
+ */
+void journal_append(const journal_event_t *event);
+
+/**
+ * @brief Sequence numbers of the oldest kept record and of the next one to be written.
+ * Safe from lwIP callbacks, like journal_read().
+ */
+void journal_range(uint32_t *first, uint32_t *next);
+
+/**
+ * @brief Copies the record with sequence number seq.
+ * @return false if it was overwritten or not written yet.
+ */
+bool journal_read(uint32_t seq, journal_event_t *event);
+
+#endif // JOURNAL_H
@@ -23,6 +23,17 @@
 #define DEFAULT_RAW_RECVMBOX_SIZE   8
 #define DEFAULT_ACCEPTMBOX_SIZE     8
 
+// altcp + mbedTLS for the global API (https://)
+#define LWIP_ALTCP                  1
+#define LWIP_ALTCP_TLS              1
+#define LWIP_ALTCP_TLS_MBEDTLS      1
+// Read when a TLS config is created. http_client.c keeps it at
+// MBEDTLS_SSL_VERIFY_REQUIRED, so a certificate that does not verify against
+// the CA ends the handshake; only an explicit opt-out (API_TLS_ALLOW_UNVERIFIED)
+// lowers it, and then only for a build without a CA
+extern int altcp_mbedtls_authmode;
+#define ALTCP_MBEDTLS_AUTHMODE      altcp_mbedtls_authmode
+
 #define TCP_MSS                     1460
 // #define TCP_WND                     (8 * TCP_MSS)
 // #define TCP_SND_BUF                 (8 * TCP_MSS)
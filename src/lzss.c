@@ -0,0 +1,106 @@
+/**
+ * @file lzss.c
+ * @brief Implementation of the LZSS codec.
+ *
+ * The encoder does a plain backwards search over LZSS_SEARCH_WINDOW bytes. It
+ * needs no RAM besides the output buffer, and bodies here are at most a few KB.
+ *
+ * @author Robson Gomes
+ */
+
+#include "lzss.h"
+
+size_t lzss_compress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size) {
+    size_t ip = 0;
+    size_t op = 0;
+    size_t flag_pos = 0;
+    uint8_t bit = 8;
+
+    while (ip < in_len) {
+        if (bit == 8) {
+            if (op >= out_size) return 0;
+            flag_pos = op;
+            out[op++] = 0;
+            bit = 0;
+        }
+
+        // Longest match inside the window (may overlap the current position)
+        size_t best_len = 0;
+        size_t best_dist = 0;
+        size_t start = ip > LZSS_SEARCH_WINDOW ? ip - LZSS_SEARCH_WINDOW : 0;
+        for (size_t cand = start; cand < ip; cand++) {
+            size_t len = 0;
+            while (len < LZSS_MAX_MATCH && ip + len < in_len && in[cand + len] == in[ip + len]) len++;
+            if (len > best_len) {
+                best_len = len;
+                best_dist = ip - cand;
+                if (len == LZSS_MAX_MATCH) break;
+            }
+        }
+
+        if (best_len >= LZSS_MIN_MATCH) {
+            if (op + 2 > out_size) return 0;
+            size_t d = best_dist - 1;
+            out[op++] = (uint8_t)(d & 0xFF);
+            out[op++] = (uint8_t)(((d >> 4) & 0xF0) | (best_len - LZSS_MIN_MATCH));
+            ip += best_len;
+        } else {
+            if (op + 1 > out_size) return 0;
+            out[flag_pos] |= (uint8_t)(1u << bit);
+            out[op++] = in[ip++];
+        }
+        bit++;
+    }
+
+    return op < in_len ? op : 0;
+}
+
+void lzss_decoder_init(lzss_decoder_t *decoder) {
+    decoder->flags = 0;
+    decoder->flag_bits = 0;
+    decoder->pending = -1;
+}
+
+bool lzss_decode(lzss_decoder_t *decoder, const uint8_t *in, size_t in_len,
+                 uint8_t *out, size_t *out_pos, size_t out_size) {
+    size_t pos = *out_pos;
+    bool ok = true;
+
+    for (size_t i = 0; i < in_len && ok; i++) {
+        uint8_t c = in[i];
+
+        if (decoder->flag_bits == 0) {
+            decoder->flags = c;
+            decoder->flag_bits = 8;
+            continue;
+        }
+
+        if (decoder->flags & 1) {
+            if (pos >= out_size) {
+                ok = false;
+                break;
+            }
+            out[pos++] = c;
+        } else if (decoder->pending < 0) {
+            decoder->pending = c; // first half of a match
+            continue;
+        } else {
+            size_t dist = ((size_t)(c & 0xF0) << 4 | (size_t)decoder->pending) + 1;
+            size_t len = (size_t)(c & 0x0F) + LZSS_MIN_MATCH;
+            decoder->pending = -1;
+
+            if (dist > pos || pos + len > out_size) {
+                ok = false;
+                break;
+            }
+            // Byte by byte: the source may overlap the bytes being written
+            for (size_t k = 0; k < len; k++, pos++) out[pos] = out[pos - dist];
+        }
+
+        decoder->flags >>= 1;
+        decoder->flag_bits--;
+    }
+
+    *out_pos = pos;
+    return ok;
+}
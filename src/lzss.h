@@ -0,0 +1,63 @@
+/**
+ * @file lzss.h
+ * @brief Definitions for the LZSS codec used to compress HTTP bodies.
+ *
+ * Format: a flag byte precedes every group of 8 items, LSB first. A set bit
+ * is a literal byte; a clear bit is a 2-byte match holding a 12-bit distance
+ * (1..4096) and a 4-bit length (3..18):
+ *
+ *   byte0 = (distance - 1) & 0xFF
+ *   byte1 = ((distance - 1) >> 4 & 0xF0) | (length - 3)
+ *
+ * The decoder needs no window of its own: matches are copied from the output
+ * already produced, so it can decode straight into the response buffer.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZSS_MIN_MATCH 3
+#define LZSS_MAX_MATCH 18
+#define LZSS_MAX_DISTANCE 4096
+#define LZSS_SEARCH_WINDOW 512 // bytes searched back by the encoder (<= LZSS_MAX_DISTANCE)
+
+/**
+ * @brief Streaming decoder state. Items may be split across input chunks.
+ */
+typedef struct {
+    uint8_t flags;
+    uint8_t flag_bits; // items left in the current group
+    int16_t pending;   // first byte of a match waiting for its second, -1 if none
+} lzss_decoder_t;
+
+/**
+ * @brief Compresses a buffer in one pass.
+ * @return Compressed size, or 0 if the output would not be smaller than the input.
+ */
+size_t lzss_compress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size);
+
+/**
+ * @brief Resets a decoder before a new stream.
+ */
+void lzss_decoder_init(lzss_decoder_t *decoder);
+
+/**
+ * @brief Decodes a chunk of a stream.
+ *
+ * @param out Start of the decoded stream (matches are read back from it).
+ * @param out_pos Bytes already decoded into out; advanced by this call.
+ * @param out_size Capacity of out.
+ * @return false if the output is full or the stream is corrupt.
+ */
+bool lzss_decode(lzss_decoder_t *decoder, const uint8_t *in, size_t in_len,
+                 uint8_t *out, size_t *out_pos, size_t out_size);
+
+#endif // LZSS_H
@@ -34,7 +34,7 @@
 #define PRIO_TASK_OLED       4
 #define PRIO_TASK_CLOCK_SYNC 1
 #define PRIO_TASK_LED        5
-#define PRIO_TASK_AHT10      12  // Monitoramento de sensores
+#define PRIO_TASK_AHT10      6   // Monitoramento de sensores (I2C por interrupção, não precisa de prioridade alta)
 #define PRIO_TASK_IRRIGATOR  10 // Prioridade crítica para controle do hardware
 #define PRIO_TASK_BUTTON     11 // Prioridade máxima para garantir inicialização rápida das interrupções
 
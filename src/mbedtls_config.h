@@ -0,0 +1,80 @@
+#ifndef _MBEDTLS_CONFIG_H
+#define _MBEDTLS_CONFIG_H
+
+// mbedTLS configuration for the global API client (TLS 1.2, client only).
+// Based on the pico-examples TLS client config, plus session tickets so
+// reconnections can resume instead of repeating the full handshake.
+
+// Workaround for some mbedtls source files using INT_MAX without including limits.h
+#include <limits.h>
+
+#define MBEDTLS_NO_PLATFORM_ENTROPY
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+#define MBEDTLS_ENTROPY_HARDWARE_ALT
+
+// No MBEDTLS_HAVE_TIME: the SDK has no time() or mbedtls_ms_time() for it, and
+// nothing here needs it. A TLS 1.2 client resumes from a ticket or session ID
+// without a clock, and certificate dates are only checked with HAVE_TIME_DATE.
+
+// Record buffers, allocated per connection from the C heap (next to the
+// 128 KB FreeRTOS heap), and up to three connections are open at once (sync,
+// events, command poll). The client asks for 4 KB records with the
+// max_fragment_length extension, so each connection holds 4 + 2 KB instead
+// of 16 + 2 KB. A server that ignores the extension sends 16 KB records and
+// fails the handshake; for it, set IN_CONTENT_LEN back to 16384 (about 36 KB
+// more in all). Bodies larger than OUT_CONTENT_LEN are sent as several records.
+#define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+#define MBEDTLS_SSL_IN_CONTENT_LEN      4096
+#define MBEDTLS_SSL_OUT_CONTENT_LEN     2048
+
+#define MBEDTLS_SSL_PROTO_TLS1_2
+#define MBEDTLS_SSL_CLI_C
+#define MBEDTLS_SSL_TLS_C
+#define MBEDTLS_SSL_SERVER_NAME_INDICATION
+#define MBEDTLS_SSL_SESSION_TICKETS
+
+#define MBEDTLS_KEY_EXCHANGE_RSA_ENABLED
+#define MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED
+#define MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED
+#define MBEDTLS_ECP_DP_SECP256R1_ENABLED
+#define MBEDTLS_ECP_DP_SECP384R1_ENABLED
+#define MBEDTLS_ECP_DP_CURVE25519_ENABLED
+#define MBEDTLS_ECP_NIST_OPTIM
+
+#define MBEDTLS_AES_C
+#define MBEDTLS_AES_FEWER_TABLES
+#define MBEDTLS_CIPHER_MODE_CBC
+#define MBEDTLS_GCM_C
+#define MBEDTLS_CIPHER_C
+#define MBEDTLS_CTR_DRBG_C
+#define MBEDTLS_ENTROPY_C
+#define MBEDTLS_MD_C
+#define MBEDTLS_MD5_C
+#define MBEDTLS_SHA1_C
+#define MBEDTLS_SHA224_C
+#define MBEDTLS_SHA256_C
+#define MBEDTLS_SHA256_SMALLER
+#define MBEDTLS_SHA384_C
+#define MBEDTLS_SHA512_C
+
+#define MBEDTLS_BIGNUM_C
+#define MBEDTLS_RSA_C
+#define MBEDTLS_PKCS1_V15
+#define MBEDTLS_ECP_C
+#define MBEDTLS_ECDH_C
+#define MBEDTLS_ECDSA_C
+
+#define MBEDTLS_ASN1_PARSE_C
+#define MBEDTLS_ASN1_WRITE_C
+#define MBEDTLS_BASE64_C
+#define MBEDTLS_OID_C
+#define MBEDTLS_PEM_PARSE_C
+#define MBEDTLS_PK_C
+#define MBEDTLS_PK_PARSE_C
+#define MBEDTLS_X509_USE_C
+#define MBEDTLS_X509_CRT_PARSE_C
+
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_ERROR_C
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ * @file ntp.c
+ * @brief Implementation of the NTP packet and clock selection logic.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "ntp.h"
+#include <string.h>
+
+uint64_t ntp_from_epoch_us(int64_t epoch_us)
+{
+    uint64_t seconds = (uint64_t)(epoch_us / 1000000 + NTP_DELTA);
+    uint64_t fraction = ((uint64_t)(epoch_us % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+int64_t ntp_to_epoch_us(uint64_t timestamp)
+{
+    int64_t seconds = (int64_t)(timestamp >> 32) - NTP_DELTA;
+    int64_t micros = (int64_t)(((timestamp & 0xFFFFFFFFu) * 1000000 + 0x80000000u) >> 32);
+    return seconds * 1000000 + micros;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get_u64(const uint8_t *p)
+{
+    return ((uint64_t)get_u32(p) << 32) | get_u32(p + 4);
+}
+
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    for (int i = 7; i >= 0; i--)
+    {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+// NTP short format (16.16 seconds) to microseconds
+static int64_t short_to_us(uint32_t v)
+{
+    return (int64_t)(((uint64_t)v * 1000000) >> 16);
+}
+
+void ntp_build_request(uint8_t *msg, uint64_t t1)
+{
+    memset(msg, 0, NTP_MSG_LEN);
+    msg[0] = 0x23; // LI=0, VN=4, Mode=3 (Client)
+    put_u64(msg + 40, t1); // echoed back as the origin timestamp
+}
+
+bool ntp_parse_reply(const uint8_t *msg, size_t len, uint64_t t1, int64_t t4_us, ntp_sample_t *sample)
+{
+    sample->valid = false;
+    if (len < NTP_MSG_LEN)
+        return false;
+
+    uint8_t leap = msg[0] >> 6;
+    uint8_t mode = msg[0] & 0x07;
+    uint8_t stratum = msg[1];
+    if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15)
+        return false; // not a server reply, unsynchronized or kiss-o'-death
+
+    if (get_u64(msg + 24) != t1)
+        return false; // not the answer to our last request (late or forged)
+
+    uint64_t t2 = get_u64(msg + 32);
+    uint64_t t3 = get_u64(msg + 40);
+    if (t2 == 0 || t3 == 0)
+        return false;
+
+    int64_t t1_us = ntp_to_epoch_us(t1);
+    int64_t t2_us = ntp_to_epoch_us(t2);
+    int64_t t3_us = ntp_to_epoch_us(t3);
+
+    int64_t delay = (t4_us - t1_us) - (t3_us - t2_us);
+    if (delay < 0)
+        delay = 0; // server faster than our clock resolution
+    if (delay > NTP_MAX_DELAY_US)
+        return false;
+
+    sample->offset_us = ((t2_us - t1_us) + (t3_us - t4_us)) / 2;
+    sample->delay_us = delay;
+    sample->error_us = delay / 2 + short_to_us(get_u32(msg + 4)) / 2 + short_to_us(get_u32(msg + 8));
+    if (sample->error_us < NTP_MIN_ERROR_US)
+        sample->error_us = NTP_MIN_ERROR_US;
+    sample->valid = true;
+    return true;
+}
+
+void ntp_filter(ntp_sample_t *best, const ntp_sample_t *sample)
+{
+    if (sample->valid && (!best->valid || sample->delay_us < best->delay_us))
+        *best = *sample;
+}
+
+int ntp_select(const ntp_sample_t *samples, int count, int64_t *offset_us)
+{
+    // Interval edges: +1 where one starts, -1 where one ends
+    struct
+    {
+        int64_t at;
+        int type;
+    } edges[2 * NTP_MAX_SAMPLES];
+    int valid = 0;
+    int n = 0;
+
+    for (int i = 0; i < count && n + 2 <= (int)(sizeof(edges) / sizeof(edges[0])); i++)
+    {
+        if (!samples[i].valid)
+            continue;
+        valid++;
+        edges[n].at = samples[i].offset_us - samples[i].error_us;
+        edges[n++].type = 1;
+        edges[n].at = samples[i].offset_us + samples[i].error_us;
+        edges[n++].type = -1;
+    }
+
+    // Insertion sort, starts before ends at the same point
+    for (int i = 1; i < n; i++)
+    {
+        for (int j = i; j > 0 && (edges[j].at < edges[j - 1].at || (edges[j].at == edges[j - 1].at && edges[j].type > edges[j - 1].type)); j--)
+        {
+            int64_t at = edges[j].at;
+            int type = edges[j].type;
+            edges[j] = edges[j - 1];
+            edges[j - 1].at = at;
+            edges[j - 1].type = type;
+        }
+    }
+
+    // Point inside the most intervals
+    int depth = 0;
+    int best = 0;
+    int64_t point = 0;
+    for (int i = 0; i < n; i++)
+    {
+        depth += edges[i].type;
+        if (depth > best)
+        {
+            best = depth;
+            point = edges[i].at;
+        }
+    }
+
+    if (best == 0 || best * 2 <= valid)
+        return 0; // no majority agrees
+
+    // Among the samples that agree, the most precise one
+    const ntp_sample_t *chosen = NULL;
+    for (int i = 0; i < count; i++)
+    {
+        const ntp_sample_t *s = &samples[i];
+        if (s->valid && s->offset_us - s->error_us <= point && point <= s->offset_us + s->error_us &&
+            (chosen == NULL || s->error_us < chosen->error_us))
+            chosen = s;
+    }
+
+    *offset_us = chosen->offset_us;
+    return best;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file ntp.h
+ * @brief Definitions for the NTP packet and clock selection logic.
+ *
+ * Each exchange records the four NTP timestamps: T1 (request sent, our clock),
+ * T2 (request received, server), T3 (reply sent, server) and T4 (reply
+ * received, our clock). From them:
+ *
+ *   offset = ((T2 - T1) + (T3 - T4)) / 2
+ *   delay  = (T4 - T1) - (T3 - T2)
+ *
+ * The true offset lies within offset ± (delay / 2 + the server's own root
+ * distance). Per server the sample with the smallest delay of a burst is kept
+ * (the clock filter); across servers the largest set of intervals that
+ * overlap is selected (Marzullo), so a server that is wrong cannot drag the
+ * clock away from a majority that agrees.
+ *
+ * Pure logic on epoch microseconds: no lwIP, no FreeRTOS.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef NTP_H
+#define NTP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define NTP_MSG_LEN 48
+#define NTP_PORT 123
+#define NTP_DELTA 2208988800LL // Segundos entre 1900 e 1970
+
+#define NTP_MAX_SAMPLES 8         // servers ntp_select() compares
+#define NTP_MAX_DELAY_US 500000   // slower exchanges are discarded
+#define NTP_MIN_ERROR_US 1000     // floor of a sample's error bound
+
+typedef struct
+{
+    bool valid;
+    int64_t offset_us; // to add to our clock
+    int64_t delay_us;  // round trip, minus the server's processing time
+    int64_t error_us;  // the true offset is within offset_us ± error_us
+} ntp_sample_t;
+
+/**
+ * @brief Converts epoch microseconds to an NTP timestamp (seconds since 1900, 32.32 fixed point).
+ */
+uint64_t ntp_from_epoch_us(int64_t epoch_us);
+
+/**
+ * @brief Converts an NTP timestamp to epoch microseconds.
+ */
+int64_t ntp_to_epoch_us(uint64_t timestamp);
+
+/**
+ * @brief Fills a client request whose transmit timestamp is T1.
+ */
+void ntp_build_request(uint8_t *msg, uint64_t t1);
+
+/**
+ * @brief Validates a server reply to the request sent at t1 and computes its sample.
+ * @param t4_us Epoch microseconds (our clock) when the reply arrived.
+ * @return false if the reply is malformed, unsynchronized, not an answer to
+ * that request or too slow.
+ */
+bool ntp_parse_reply(const uint8_t *msg, size_t len, uint64_t t1, int64_t t4_us, ntp_sample_t *sample);
+
+/**
+ * @brief Clock filter: keeps in best the sample with the smallest delay.
+ */
+void ntp_filter(ntp_sample_t *best, const ntp_sample_t *sample);
+
+/**
+ * @brief Selects the offset agreed on by a majority of the valid samples.
+ * @return Number of samples that agree (0 if there is no majority).
+ */
+int ntp_select(const ntp_sample_t *samples, int count, int64_t *offset_us);
+
+#endif // NTP_H
@@ -8,8 +8,8 @@
 #include "BMSPA_font.h"
 #include "irrigator.h"
 #include "aht10.h"
-#include "hardware/rtc.h"
 #include "clock.h"
+#include "fixed.h"
 
 #include <stdio.h>
 
@@ -49,8 +49,8 @@ void oled_task(void *pvParameters)
     char irrigator_status[20];
     
     uint8_t data[6] = {0};
-    float temp = 0.0;
-    float hum = 0.0;
+    int32_t temp = 0;
+    int32_t hum = 0;
     char temperature_status[20];
     char humidity_status[20];
     char date_string[20];
@@ -61,8 +61,10 @@ void oled_task(void *pvParameters)
     {
         aht10_get_latest_readings(&temp, &hum);
 
-        snprintf(temperature_status, sizeof(temperature_status), "%.2f C", temp);
-        snprintf(humidity_status, sizeof(humidity_status), "%.2f %%", hum);
+        int len = fixed_format(temperature_status, temp, 2);
+        snprintf(temperature_status + len, sizeof(temperature_status) - len, " C");
+        len = fixed_format(humidity_status, hum, 2);
+        snprintf(humidity_status + len, sizeof(humidity_status) - len, " %%");
 
         snprintf(irrigator_status, sizeof(irrigator_status), "%s", irrigator_is_on() ? "LIGADO" : "DESLIGADO");
 
@@ -0,0 +1,152 @@
+/**
+ * @file outbox.c
+ * @brief Implementation of the prioritized outbound message queue.
+ *
+ * Each class is a ring of fixed-size records. Records carry a sequence number
+ * so a batch can be acknowledged even if older records were dropped while it
+ * was in flight.
+ *
+ * @author Robson Gomes
+ */
+
+#include "outbox.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef struct {
+    char (*records)[OUTBOX_RECORD_SIZE];
+    uint32_t *seqs;
+    int capacity;
+    int budget;
+    int head;
+    int count;
+    uint32_t batch_last_seq; // newest record taken by the outstanding batch
+    bool batch_taken;
+} outbox_queue_t;
+
+static char urgent_records[OUTBOX_URGENT_CAPACITY][OUTBOX_RECORD_SIZE];
+static char state_records[OUTBOX_STATE_CAPACITY][OUTBOX_RECORD_SIZE];
+static char bulk_records[OUTBOX_BULK_CAPACITY][OUTBOX_RECORD_SIZE];
+static uint32_t urgent_seqs[OUTBOX_URGENT_CAPACITY];
+static uint32_t state_seqs[OUTBOX_STATE_CAPACITY];
+static uint32_t bulk_seqs[OUTBOX_BULK_CAPACITY];
+
+// Indexed by outbox_class_t, in priority order
+static outbox_queue_t queues[OUTBOX_CLASS_COUNT] = {
+    [OUTBOX_URGENT] = { .records = urgent_records, .seqs = urgent_seqs, .capacity = OUTBOX_URGENT_CAPACITY, .budget = OUTBOX_URGENT_BUDGET },
+    [OUTBOX_STATE] = { .records = state_records, .seqs = state_seqs, .capacity = OUTBOX_STATE_CAPACITY, .budget = OUTBOX_STATE_BUDGET },
+    [OUTBOX_BULK] = { .records = bulk_records, .seqs = bulk_seqs, .capacity = OUTBOX_BULK_CAPACITY, .budget = OUTBOX_BULK_BUDGET },
+};
+
+static uint32_t next_seq = 1;
+static bool batch_active = false;
+
+static bool seq_taken(const outbox_queue_t *q, uint32_t seq) {
+    return q->batch_taken && (int32_t)(seq - q->batch_last_seq) <= 0;
+}
+
+bool outbox_push(outbox_class_t cls, const char *json) {
+    if (cls >= OUTBOX_CLASS_COUNT) return false;
+
+    size_t len = strlen(json);
+    if (len >= OUTBOX_RECORD_SIZE) {
+        printf("Outbox: Message too long (%d bytes), rejected\n", (int)len);
+        return false;
+    }
+
+    outbox_queue_t *q = &queues[cls];
+    bool dropped = false;
+
+    taskENTER_CRITICAL();
+    if (q->count == q->capacity) {
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        dropped = true;
+    }
+    int idx = (q->head + q->count) % q->capacity;
+    memcpy(q->records[idx], json, len + 1);
+    q->seqs[idx] = next_seq++;
+    q->count++;
+    taskEXIT_CRITICAL();
+
+    if (dropped) {
+        printf("Outbox: Class %d full, oldest message dropped\n", (int)cls);
+    }
+    return !dropped;
+}
+
+int outbox_count(outbox_class_t cls) {
+    if (cls >= OUTBOX_CLASS_COUNT) return 0;
+    return queues[cls].count;
+}
+
+int outbox_waiting(void) {
+    int waiting = 0;
+
+    taskENTER_CRITICAL();
+    for (int c = 0; c < OUTBOX_CLASS_COUNT; c++) {
+        const outbox_queue_t *q = &queues[c];
+        for (int i = 0; i < q->count; i++) {
+            if (!seq_taken(q, q->seqs[(q->head + i) % q->capacity])) waiting++;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return waiting;
+}
+
+int outbox_build_batch(char *buffer, size_t size) {
+    if (batch_active) return 0;
+
+    int offset = snprintf(buffer, size, "{\"events\":[");
+    int taken = 0;
+
+    taskENTER_CRITICAL();
+    for (int c = 0; c < OUTBOX_CLASS_COUNT; c++) {
+        outbox_queue_t *q = &queues[c];
+        int used = 0;
+        q->batch_taken = false;
+
+        for (int i = 0; i < q->count; i++) {
+            int idx = (q->head + i) % q->capacity;
+            int len = (int)strlen(q->records[idx]);
+
+            // Class budget, and room for ',' plus the closing "]}"
+            if (used + len + 1 > q->budget) break;
+            if (offset + len + 1 + 3 > (int)size) break;
+
+            if (taken > 0) buffer[offset++] = ',';
+            memcpy(buffer + offset, q->records[idx], len);
+            offset += len;
+            used += len + 1;
+
+            q->batch_last_seq = q->seqs[idx];
+            q->batch_taken = true;
+            taken++;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    snprintf(buffer + offset, size - offset, "]}");
+    batch_active = taken > 0;
+    return taken;
+}
+
+void outbox_complete_batch(bool delivered) {
+    taskENTER_CRITICAL();
+    for (int c = 0; c < OUTBOX_CLASS_COUNT; c++) {
+        outbox_queue_t *q = &queues[c];
+        if (delivered) {
+            while (q->count > 0 && seq_taken(q, q->seqs[q->head])) {
+                q->head = (q->head + 1) % q->capacity;
+                q->count--;
+            }
+        }
+        q->batch_taken = false;
+    }
+    batch_active = false;
+    taskEXIT_CRITICAL();
+}
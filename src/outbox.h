@@ -0,0 +1,77 @@
+/**
+ * @file outbox.h
+ * @brief Definitions for the prioritized outbound message queue of the global API.
+ *
+ * Messages are small JSON objects queued by class. A batch always takes the
+ * urgent class first, then state changes, then bulk history, and each class
+ * is capped by its own byte budget per batch, so a history backlog after an
+ * outage can never delay an acknowledgement or an alarm by more than one batch.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    OUTBOX_URGENT = 0, // actuation acknowledgements and alarms
+    OUTBOX_STATE,      // state changes (irrigator on/off, ...)
+    OUTBOX_BULK,       // telemetry history kept while the server was unreachable
+    OUTBOX_CLASS_COUNT
+} outbox_class_t;
+
+#define OUTBOX_RECORD_SIZE 112 // max JSON object length, NUL included
+
+#define OUTBOX_URGENT_CAPACITY 8
+#define OUTBOX_STATE_CAPACITY 16
+#define OUTBOX_BULK_CAPACITY 48
+
+// Bytes of each class that may go into one batch
+#define OUTBOX_URGENT_BUDGET 1024
+#define OUTBOX_STATE_BUDGET 512
+#define OUTBOX_BULK_BUDGET 768
+
+// Largest body outbox_build_batch() can produce
+#define OUTBOX_BATCH_MAX_SIZE (OUTBOX_URGENT_BUDGET + OUTBOX_STATE_BUDGET + OUTBOX_BULK_BUDGET + 32)
+
+/**
+ * @brief Queues a message. When the class is full its oldest message is dropped.
+ * Safe to call from any task.
+ * @param cls Message class.
+ * @param json JSON object, truncated messages are rejected.
+ * @return false if the message was rejected or another one had to be dropped.
+ */
+bool outbox_push(outbox_class_t cls, const char *json);
+
+/**
+ * @brief Number of queued messages of a class, including those in the current batch.
+ */
+int outbox_count(outbox_class_t cls);
+
+/**
+ * @brief Number of queued messages not yet taken by the current batch.
+ */
+int outbox_waiting(void);
+
+/**
+ * @brief Builds {"events":[...]} from the queued messages, by priority and budget.
+ *
+ * Only one batch may be outstanding: call outbox_complete_batch() before
+ * building the next one.
+ *
+ * @return Number of messages in the batch (0 if nothing was written).
+ */
+int outbox_build_batch(char *buffer, size_t size);
+
+/**
+ * @brief Ends the outstanding batch.
+ * @param delivered true removes the batch messages, false keeps them for the next batch.
+ */
+void outbox_complete_batch(bool delivered);
+
+#endif // OUTBOX_H
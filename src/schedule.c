@@ -0,0 +1,197 @@
+/**
+ * @file schedule.c
+ * @brief Implementation of the irrigation schedule store.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "schedule.h"
+#include <string.h>
+
+static int minute_of_week(const datetime_t *t)
+{
+    return t->dotw * 24 * 60 + t->hour * 60 + t->min;
+}
+
+// First index position whose minute is >= minute
+static int lower_bound(const schedule_store_t *store, int minute)
+{
+    int lo = 0;
+    int hi = store->index_len;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (store->index[mid].minute_of_week < minute)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void index_remove(schedule_store_t *store, int entry)
+{
+    int out = 0;
+    for (int i = 0; i < store->index_len; i++)
+    {
+        if (store->index[i].entry != entry)
+            store->index[out++] = store->index[i];
+    }
+    store->index_len = out;
+}
+
+static void index_insert(schedule_store_t *store, int entry, int minute)
+{
+    int pos = lower_bound(store, minute);
+    memmove(&store->index[pos + 1], &store->index[pos], (store->index_len - pos) * sizeof(store->index[0]));
+    store->index[pos].minute_of_week = (uint16_t)minute;
+    store->index[pos].entry = (uint16_t)entry;
+    store->index_len++;
+}
+
+static int days_in_month(int year, int month)
+{
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0))
+        return 29;
+    return days[month - 1];
+}
+
+// Days since 2000-01-01 (proleptic Gregorian)
+int32_t schedule_days_from_date(int year, int month, int day)
+{
+    year -= month <= 2;
+    int32_t era = year / 400;
+    int32_t yoe = year - era * 400;
+    int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 730425; // 730425 = days from 0000-03-01 to 2000-01-01
+}
+
+void schedule_date_from_days(int32_t days, int *year, int *month, int *day)
+{
+    days += 730425;
+    int32_t era = days / 146097;
+    int32_t doe = days - era * 146097;
+    int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int32_t mp = (5 * doy + 2) / 153;
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = yoe + era * 400 + (*month <= 2);
+}
+
+uint32_t schedule_minute_of(const datetime_t *t)
+{
+    int32_t days = schedule_days_from_date(t->year, t->month, t->day);
+    if (days < 0)
+        return 0;
+    return (uint32_t)days * 24 * 60 + t->hour * 60 + t->min;
+}
+
+void schedule_date_of(uint32_t minute, datetime_t *t)
+{
+    int year, month, day;
+    int32_t days = (int32_t)(minute / (24 * 60));
+    schedule_date_from_days(days, &year, &month, &day);
+
+    t->year = (int16_t)year;
+    t->month = (int8_t)month;
+    t->day = (int8_t)day;
+    t->dotw = (int8_t)((days + 6) % 7); // 2000-01-01 was a Saturday
+    t->hour = (int8_t)(minute / 60 % 24);
+    t->min = (int8_t)(minute % 60);
+    t->sec = 0;
+}
+
+void schedule_store_init(schedule_store_t *store)
+{
+    memset(store, 0, sizeof(*store));
+}
+
+bool schedule_store_set(schedule_store_t *store, int index, const schedule_item_t *item)
+{
+    if (index < 0 || index >= SCHEDULE_MAX_ENTRIES)
+        return false;
+
+    index_remove(store, index);
+    store->entries[index] = *item;
+
+    if (item->active && item->hour < 24 && item->minute < 60)
+    {
+        for (int d = 0; d < 7; d++)
+        {
+            if (item->days & (1 << d))
+                index_insert(store, index, d * 24 * 60 + item->hour * 60 + item->minute);
+        }
+    }
+    return true;
+}
+
+bool schedule_in_season(const schedule_item_t *item, int month, int day)
+{
+    if (item->season_start == 0 || item->season_end == 0)
+        return true;
+
+    int date = month * 100 + day;
+    if (item->season_start <= item->season_end)
+        return date >= item->season_start && date <= item->season_end;
+    return date >= item->season_start || date <= item->season_end; // wraps past December
+}
+
+int schedule_store_due(const schedule_store_t *store, const datetime_t *t, uint16_t *out, int max)
+{
+    int minute = minute_of_week(t);
+    int count = 0;
+
+    for (int i = lower_bound(store, minute); i < store->index_len; i++)
+    {
+        const schedule_index_item_t *it = &store->index[i];
+        if (it->minute_of_week != minute)
+            break;
+        if (!schedule_in_season(&store->entries[it->entry], t->month, t->day))
+            continue;
+        if (count < max)
+            out[count] = it->entry;
+        count++;
+    }
+    return count;
+}
+
+int32_t schedule_store_minutes_to_next(const schedule_store_t *store, const datetime_t *t, bool skip_current)
+{
+    if (store->index_len == 0)
+        return -1;
+
+    int now = minute_of_week(t);
+    int from = (now + (skip_current ? 1 : 0)) % SCHEDULE_MINUTES_PER_WEEK;
+    int start = lower_bound(store, from);
+
+    for (int k = 0; k < store->index_len; k++)
+    {
+        const schedule_index_item_t *it = &store->index[(start + k) % store->index_len];
+        int32_t delta = (it->minute_of_week - now + SCHEDULE_MINUTES_PER_WEEK) % SCHEDULE_MINUTES_PER_WEEK;
+        if (delta == 0 && skip_current)
+            delta = SCHEDULE_MINUTES_PER_WEEK; // same minute next week
+
+        // Date of that start, at most 7 days ahead
+        int year = t->year;
+        int month = t->month;
+        int day = t->day + (t->hour * 60 + t->min + delta) / (24 * 60);
+        while (day > days_in_month(year, month))
+        {
+            day -= days_in_month(year, month);
+            if (++month > 12)
+            {
+                month = 1;
+                year++;
+            }
+        }
+
+        if (schedule_in_season(&store->entries[it->entry], month, day))
+            return delta;
+    }
+    return -1;
+}
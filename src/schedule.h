@@ -0,0 +1,115 @@
+/**
+ * @file schedule.h
+ * @brief Definitions for the irrigation schedule store.
+ *
+ * Entries have a start time, a day-of-week mask and an optional seasonal date
+ * range. Active entries are kept in an index sorted by minute of the week, so
+ * "what starts at this minute" and "when is the next start" are binary
+ * searches instead of scans over every entry.
+ *
+ * The store is plain data with no locking; the owner serializes access.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/util/datetime.h"
+
+#define SCHEDULE_MAX_ENTRIES 256
+#define SCHEDULE_MINUTES_PER_WEEK (7 * 24 * 60)
+
+// Day-of-week mask bits, following datetime_t.dotw (0 = Sunday)
+#define SCHEDULE_SUNDAY (1 << 0)
+#define SCHEDULE_MONDAY (1 << 1)
+#define SCHEDULE_TUESDAY (1 << 2)
+#define SCHEDULE_WEDNESDAY (1 << 3)
+#define SCHEDULE_THURSDAY (1 << 4)
+#define SCHEDULE_FRIDAY (1 << 5)
+#define SCHEDULE_SATURDAY (1 << 6)
+#define SCHEDULE_EVERY_DAY 0x7F
+
+struct schedule_item
+{
+    uint8_t hour;
+    uint8_t minute;
+    uint16_t duration; // in seconds, up to IRRIGATOR_MAX_DURATION_S
+    uint8_t active;
+    uint8_t zone;
+    uint8_t days;     // day-of-week mask, 0 = slot unused
+    uint16_t season_start; // MMDD, inclusive; 0 = all year
+    uint16_t season_end;   // MMDD, inclusive; may wrap past December
+};
+
+typedef struct schedule_item schedule_item_t;
+
+typedef struct
+{
+    uint16_t minute_of_week;
+    uint16_t entry;
+} schedule_index_item_t;
+
+typedef struct
+{
+    schedule_item_t entries[SCHEDULE_MAX_ENTRIES];
+    schedule_index_item_t index[SCHEDULE_MAX_ENTRIES * 7]; // sorted by minute_of_week
+    int index_len;
+} schedule_store_t;
+
+/**
+ * @brief Days since 2000-01-01 of a date (negative before it).
+ */
+int32_t schedule_days_from_date(int year, int month, int day);
+
+/**
+ * @brief Date of a schedule_days_from_date() value.
+ */
+void schedule_date_from_days(int32_t days, int *year, int *month, int *day);
+
+/**
+ * @brief Minutes since 2000-01-01 00:00 of a local date, a time line that does
+ * not wrap every week like the index does.
+ */
+uint32_t schedule_minute_of(const datetime_t *t);
+
+/**
+ * @brief Local date of a schedule_minute_of() value, dotw included and sec = 0.
+ */
+void schedule_date_of(uint32_t minute, datetime_t *t);
+
+void schedule_store_init(schedule_store_t *store);
+
+/**
+ * @brief Replaces an entry and updates the index (O(n) moves, no sorting).
+ * @return false if index is out of range.
+ */
+bool schedule_store_set(schedule_store_t *store, int index, const schedule_item_t *item);
+
+/**
+ * @brief Whether the season of an entry includes a date.
+ */
+bool schedule_in_season(const schedule_item_t *item, int month, int day);
+
+/**
+ * @brief Lists the entries that start at the minute of t (active and in season).
+ * @return Number of such entries; only the first max are written to out.
+ */
+int schedule_store_due(const schedule_store_t *store, const datetime_t *t, uint16_t *out, int max);
+
+/**
+ * @brief Minutes from the start of the current minute until the next start.
+ *
+ * Walks the index from the current minute, skipping entries out of season,
+ * so it is O(log n) unless many entries are out of season.
+ *
+ * @param skip_current Ignore starts in the current minute (already handled).
+ * @return Minutes (0 = due now), or -1 if nothing starts within a week.
+ */
+int32_t schedule_store_minutes_to_next(const schedule_store_t *store, const datetime_t *t, bool skip_current);
+
+#endif // SCHEDULE_H
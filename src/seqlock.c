@@ -0,0 +1,59 @@
+/**
+ * @file seqlock.c
+ * @brief Implementation of the sequence lock.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "seqlock.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+uint32_t seqlock_write_begin(seqlock_t *lock)
+{
+    uint32_t saved = save_and_disable_interrupts();
+    lock->seq++;
+    __dmb(); // odd sequence visible before the data changes
+    return saved;
+}
+
+void seqlock_write_end(seqlock_t *lock, uint32_t saved)
+{
+    __dmb(); // data visible before the sequence is even again
+    lock->seq++;
+    restore_interrupts(saved);
+}
+
+void seqlock_write(seqlock_t *lock, void *dst, const void *src, size_t size)
+{
+    uint32_t saved = seqlock_write_begin(lock);
+    memcpy(dst, src, size);
+    seqlock_write_end(lock, saved);
+}
+
+uint32_t seqlock_read_begin(const seqlock_t *lock)
+{
+    uint32_t seq;
+    while ((seq = lock->seq) & 1)
+        tight_loop_contents(); // only another core can be mid-update, an interrupt cannot
+    __dmb();
+    return seq;
+}
+
+bool seqlock_read_retry(const seqlock_t *lock, uint32_t start)
+{
+    __dmb();
+    return lock->seq != start;
+}
+
+void seqlock_read(const seqlock_t *lock, void *dst, const void *src, size_t size)
+{
+    uint32_t seq;
+    do
+    {
+        seq = seqlock_read_begin(lock);
+        memcpy(dst, src, size);
+    } while (seqlock_read_retry(lock, seq));
+}
@@ -0,0 +1,61 @@
+/**
+ * @file seqlock.h
+ * @brief Sequence lock for publishing shared state without blocking readers.
+ *
+ * The writer makes the sequence odd, updates the data and makes it even
+ * again. A reader copies the data and retries if the sequence was odd or
+ * changed meanwhile, so it always ends with a consistent snapshot and never
+ * takes a lock.
+ *
+ * A writer must not be interrupted by a reader on the same core (a reader
+ * spinning in an interrupt would never see the write finish), so writes mask
+ * interrupts. With FreeRTOS on a single core that also serializes writers;
+ * with writers on both cores the caller must serialize them.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct
+{
+    volatile uint32_t seq;
+} seqlock_t;
+
+#define SEQLOCK_INIT { 0 }
+
+/**
+ * @brief Starts an in-place update. Interrupts stay masked until seqlock_write_end().
+ * @return Interrupt state to hand to seqlock_write_end().
+ */
+uint32_t seqlock_write_begin(seqlock_t *lock);
+void seqlock_write_end(seqlock_t *lock, uint32_t saved);
+
+/**
+ * @brief Copies size bytes from src into the protected dst as one update.
+ */
+void seqlock_write(seqlock_t *lock, void *dst, const void *src, size_t size);
+
+/**
+ * @brief Waits for no write in progress and returns the sequence to check later.
+ */
+uint32_t seqlock_read_begin(const seqlock_t *lock);
+
+/**
+ * @brief Whether what was read since seqlock_read_begin() must be read again.
+ */
+bool seqlock_read_retry(const seqlock_t *lock, uint32_t start);
+
+/**
+ * @brief Copies a consistent snapshot of the protected src into dst.
+ */
+void seqlock_read(const seqlock_t *lock, void *dst, const void *src, size_t size);
+
+#endif // SEQLOCK_H
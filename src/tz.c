@@ -0,0 +1,106 @@
+/**
+ * @file tz.c
+ * @brief Implementation of the time zone rules.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "tz.h"
+#include "schedule.h"
+
+#define SECONDS_1970_TO_2000 946684800LL
+
+static const tz_rule_t zones[] = {
+    [TZ_UTC] = { "UTC", 0, 0 },
+    [TZ_AMERICA_SAO_PAULO] = { "America/Sao_Paulo", -3 * 3600, 0 },
+    [TZ_AMERICA_MANAUS] = { "America/Manaus", -4 * 3600, 0 },
+    [TZ_AMERICA_NORONHA] = { "America/Noronha", -2 * 3600, 0 },
+    [TZ_AMERICA_NEW_YORK] = { "America/New_York", -5 * 3600, 3600, { 3, 2, 0, 2 }, { 11, 1, 0, 2 } },
+    [TZ_EUROPE_LISBON] = { "Europe/Lisbon", 0, 3600, { 3, TZ_LAST_WEEK, 0, 1 }, { 10, TZ_LAST_WEEK, 0, 2 } },
+    [TZ_EUROPE_BERLIN] = { "Europe/Berlin", 3600, 3600, { 3, TZ_LAST_WEEK, 0, 2 }, { 10, TZ_LAST_WEEK, 0, 3 } },
+    [TZ_AUSTRALIA_SYDNEY] = { "Australia/Sydney", 10 * 3600, 3600, { 10, 1, 0, 2 }, { 4, 1, 0, 3 } },
+};
+
+static const tz_rule_t *const rule = &zones[TZ_ZONE];
+
+const tz_rule_t *tz_rule(void)
+{
+    return rule;
+}
+
+// Epoch time of a transition in a year, given the offset in effect before it
+static int64_t transition_utc(const tz_transition_t *tr, int year, int32_t offset_before)
+{
+    int32_t first = schedule_days_from_date(year, tr->month, 1);
+    int32_t next = tr->month == 12 ? schedule_days_from_date(year + 1, 1, 1) : schedule_days_from_date(year, tr->month + 1, 1);
+    int dotw_first = (first + 6) % 7; // 2000-01-01 was a Saturday
+
+    int32_t day = first + (tr->dotw - dotw_first + 7) % 7 + 7 * (tr->week - 1);
+    while (day >= next)
+        day -= 7; // TZ_LAST_WEEK, or a fifth week the month does not have
+
+    return SECONDS_1970_TO_2000 + (int64_t)day * 86400 + tr->hour * 3600 - offset_before;
+}
+
+// A few additions and divisions; clock_get_time() only converts once per second
+static void year_transitions(int year, int64_t *start, int64_t *end)
+{
+    *start = transition_utc(&rule->start, year, rule->offset_s);
+    *end = transition_utc(&rule->end, year, rule->offset_s + rule->dst_s);
+}
+
+static int year_of(int64_t utc_s)
+{
+    int64_t days = (utc_s - SECONDS_1970_TO_2000) / 86400;
+    int year, month, day;
+    schedule_date_from_days((int32_t)days, &year, &month, &day);
+    return year;
+}
+
+static bool in_dst(int64_t utc_s)
+{
+    int64_t start, end;
+    year_transitions(year_of(utc_s + rule->offset_s), &start, &end);
+    if (start < end)
+        return utc_s >= start && utc_s < end;
+    return utc_s >= start || utc_s < end; // southern hemisphere: DST spans the new year
+}
+
+int32_t tz_offset_at(int64_t utc_s)
+{
+    if (rule->dst_s == 0)
+        return rule->offset_s;
+    return in_dst(utc_s) ? rule->offset_s + rule->dst_s : rule->offset_s;
+}
+
+int64_t tz_local_to_utc(int64_t local_s)
+{
+    int64_t utc = local_s - rule->offset_s;
+    if (rule->dst_s == 0)
+        return utc;
+
+    // First occurrence of a repeated hour is in DST; a skipped hour stays standard
+    int64_t dst_utc = utc - rule->dst_s;
+    return in_dst(dst_utc) ? dst_utc : utc;
+}
+
+int64_t tz_seconds_to_next_change(int64_t utc_s)
+{
+    if (rule->dst_s == 0)
+        return -1;
+
+    int year = year_of(utc_s + rule->offset_s);
+    int64_t best = -1;
+    for (int y = year; y <= year + 1 && best < 0; y++)
+    {
+        int64_t start, end;
+        year_transitions(y, &start, &end);
+        if (start > utc_s)
+            best = start - utc_s;
+        if (end > utc_s && (best < 0 || end - utc_s < best))
+            best = end - utc_s;
+    }
+    return best;
+}
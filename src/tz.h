@@ -0,0 +1,78 @@
+/**
+ * @file tz.h
+ * @brief Definitions for the time zone rules.
+ *
+ * Each zone is a constant table entry: standard offset, DST saving and the
+ * two yearly transitions, written like the POSIX TZ rules ("the last Sunday
+ * of March at 01:00"). The zone in use is picked at compile time by
+ * TZ_ZONE. Converting a time is a table lookup and the arithmetic for the
+ * transitions of its year, with no gmtime() and no tz database.
+ *
+ * Pure logic on epoch seconds: no FreeRTOS.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef TZ_H
+#define TZ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Zones in tz.c
+#define TZ_UTC 0
+#define TZ_AMERICA_SAO_PAULO 1 // Brasília, sem horário de verão desde 2019
+#define TZ_AMERICA_MANAUS 2
+#define TZ_AMERICA_NORONHA 3
+#define TZ_AMERICA_NEW_YORK 4
+#define TZ_EUROPE_LISBON 5
+#define TZ_EUROPE_BERLIN 6
+#define TZ_AUSTRALIA_SYDNEY 7
+
+#ifndef TZ_ZONE
+#define TZ_ZONE TZ_AMERICA_SAO_PAULO
+#endif
+
+#define TZ_LAST_WEEK 5 // week of a transition: the last one of the month
+
+typedef struct
+{
+    uint8_t month; // 1-12
+    uint8_t week;  // 1-4, or TZ_LAST_WEEK
+    uint8_t dotw;  // 0 = Sunday
+    uint8_t hour;  // local time in effect before the transition
+} tz_transition_t;
+
+typedef struct
+{
+    const char *name;
+    int32_t offset_s;       // standard time, east of UTC
+    int32_t dst_s;          // added during DST, 0 if the zone has none
+    tz_transition_t start;  // DST begins
+    tz_transition_t end;    // DST ends
+} tz_rule_t;
+
+/**
+ * @brief The zone selected by TZ_ZONE.
+ */
+const tz_rule_t *tz_rule(void);
+
+/**
+ * @brief Offset from UTC (seconds, east positive) in effect at an epoch time.
+ */
+int32_t tz_offset_at(int64_t utc_s);
+
+/**
+ * @brief Epoch time of a local time. A local time skipped by a DST start is
+ * taken as standard time; a repeated one as its first occurrence.
+ */
+int64_t tz_local_to_utc(int64_t local_s);
+
+/**
+ * @brief Seconds from an epoch time to the next offset change, or -1 if the zone has no DST.
+ */
+int64_t tz_seconds_to_next_change(int64_t utc_s);
+
+#endif // TZ_H
@@ -0,0 +1,132 @@
+/**
+ * @file zones.c
+ * @brief Implementation of the multi-zone valve model.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#include "zones.h"
+#include <string.h>
+
+static int open_count(const zones_t *z)
+{
+    int n = 0;
+    for (int i = 0; i < z->count; i++)
+    {
+        if (z->zones[i].open)
+            n++;
+    }
+    return n;
+}
+
+static void open_zone(zone_state_t *s, bool until_stopped, uint32_t duration_ms, uint32_t now_ms)
+{
+    s->open = true;
+    s->queued = false;
+    s->until_stopped = until_stopped;
+    s->close_at = now_ms + duration_ms;
+}
+
+void zones_init(zones_t *z, int count, int capacity)
+{
+    memset(z, 0, sizeof(*z));
+    z->count = count > ZONES_MAX ? ZONES_MAX : count;
+    z->capacity = capacity < 1 ? 1 : capacity;
+}
+
+bool zones_request(zones_t *z, int zone, uint32_t duration_ms, uint32_t now_ms)
+{
+    if (zone < 0 || zone >= z->count)
+        return false;
+
+    zone_state_t *s = &z->zones[zone];
+    bool until_stopped = duration_ms == 0;
+
+    if (s->open)
+    {
+        // Overlaps the current run: extend it to cover both
+        if (until_stopped)
+            s->until_stopped = true;
+        else if (!s->until_stopped && (int32_t)(now_ms + duration_ms - s->close_at) > 0)
+            s->close_at = now_ms + duration_ms;
+    }
+    else if (s->queued)
+    {
+        // Both would start together once a slot frees: keep the longer one
+        if (until_stopped)
+            s->until_stopped = true;
+        else if (duration_ms > s->queued_ms)
+            s->queued_ms = duration_ms;
+    }
+    else if (open_count(z) < z->capacity)
+    {
+        open_zone(s, until_stopped, duration_ms, now_ms);
+    }
+    else
+    {
+        s->queued = true;
+        s->until_stopped = until_stopped;
+        s->queued_ms = duration_ms;
+        s->queued_seq = z->next_seq++;
+    }
+    return true;
+}
+
+void zones_stop(zones_t *z, int zone)
+{
+    for (int i = 0; i < z->count; i++)
+    {
+        if (zone < 0 || zone == i)
+            memset(&z->zones[i], 0, sizeof(z->zones[i]));
+    }
+}
+
+uint32_t zones_update(zones_t *z, uint32_t now_ms)
+{
+    for (int i = 0; i < z->count; i++)
+    {
+        zone_state_t *s = &z->zones[i];
+        if (s->open && !s->until_stopped && (int32_t)(s->close_at - now_ms) <= 0)
+            s->open = false;
+    }
+
+    // Hand free pump slots to the oldest queued runs
+    int free_slots = z->capacity - open_count(z);
+    while (free_slots > 0)
+    {
+        zone_state_t *oldest = NULL;
+        for (int i = 0; i < z->count; i++)
+        {
+            zone_state_t *s = &z->zones[i];
+            if (s->queued && (!oldest || (int32_t)(s->queued_seq - oldest->queued_seq) < 0))
+                oldest = s;
+        }
+        if (!oldest)
+            break;
+
+        open_zone(oldest, oldest->until_stopped, oldest->queued_ms, now_ms);
+        free_slots--;
+    }
+
+    uint32_t next = ZONES_NO_DEADLINE;
+    for (int i = 0; i < z->count; i++)
+    {
+        const zone_state_t *s = &z->zones[i];
+        if (s->open && !s->until_stopped && s->close_at - now_ms < next)
+            next = s->close_at - now_ms;
+    }
+    return next;
+}
+
+uint32_t zones_open_mask(const zones_t *z)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < z->count; i++)
+    {
+        if (z->zones[i].open)
+            mask |= 1u << i;
+    }
+    return mask;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file zones.h
+ * @brief Definitions for the multi-zone valve model.
+ *
+ * Every zone has one valve, and all valves share a pump that can feed at most
+ * `capacity` of them at once. Runs that do not fit wait in a FIFO for a free
+ * pump slot. A request for a zone that is already open or waiting is merged
+ * with that run (the union of both intervals), so a zone never occupies more
+ * than one slot or queue position.
+ *
+ * Pure logic on a caller-supplied millisecond clock: no GPIO, no FreeRTOS.
+ *
+ * @author Robson Gomes
+ * @email robson.mesquita56@gmail.com
+ * @github github.com/rob-ec
+ */
+
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ZONES_MAX 8
+#define ZONES_NO_DEADLINE UINT32_MAX
+
+typedef struct
+{
+    bool open;
+    bool queued;
+    bool until_stopped;  // open (or queued) without a duration
+    uint32_t close_at;   // ms, when open and timed
+    uint32_t queued_ms;  // run length once a pump slot frees up
+    uint32_t queued_seq; // FIFO order among queued zones
+} zone_state_t;
+
+typedef struct
+{
+    zone_state_t zones[ZONES_MAX];
+    int count;
+    int capacity;
+    uint32_t next_seq;
+} zones_t;
+
+/**
+ * @param count Number of zones (at most ZONES_MAX).
+ * @param capacity Valves the pump can feed at once (at least 1).
+ */
+void zones_init(zones_t *z, int count, int capacity);
+
+/**
+ * @brief Requests a run. Opens the zone now if the pump has a free slot,
+ * otherwise queues it; merges with a run the zone already has.
+ * Call zones_update() afterwards to apply it.
+ * @param duration_ms 0 keeps the zone open until zones_stop().
+ * @return false if zone is out of range.
+ */
+bool zones_request(zones_t *z, int zone, uint32_t duration_ms, uint32_t now_ms);
+
+/**
+ * @brief Closes a zone and drops its queued run. zone < 0 stops every zone.
+ */
+void zones_stop(zones_t *z, int zone);
+
+/**
+ * @brief Closes expired runs and starts queued ones while slots are free.
+ * @return ms until the next run ends, or ZONES_NO_DEADLINE.
+ */
+uint32_t zones_update(zones_t *z, uint32_t now_ms);
+
+/**
+ * @brief Bit n set when zone n is open.
+ */
+uint32_t zones_open_mask(const zones_t *z);
+
+#endif // ZONES_H